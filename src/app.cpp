@@ -66,6 +66,8 @@ NatronPluginManager::NatronPluginManager(QWidget *parent)
     , _installedLabel(nullptr)
     , _updatesLabel(nullptr)
     , _cacheLabel(nullptr)
+    , _cancelAction(nullptr)
+    , _undoAction(nullptr)
 {
 #ifdef Q_OS_DARWIN
     setWindowTitle(tr("Natron Plug-in Manager"));
@@ -260,6 +262,10 @@ void NatronPluginManager::setupPlugins()
             SIGNAL(updatedPlugins()),
             this,
             SLOT(handleUpdatedPlugins()));
+    connect(_plugins,
+            SIGNAL(updatedPlugin(QString,int)),
+            this,
+            SLOT(handleUpdatedPlugin(QString,int)));
     connect(_plugins,
             SIGNAL(updatedCache()),
             this,
@@ -276,6 +282,22 @@ void NatronPluginManager::setupPlugins()
             SIGNAL(statusDownload(QString,qint64,qint64)),
             this,
             SLOT(handleDownloadStatusMessage(QString,qint64,qint64)));
+    connect(_plugins,
+            SIGNAL(batchItemFinished(QString,int,bool,bool,QString)),
+            this,
+            SLOT(handleBatchItemFinished(QString,int,bool,bool,QString)));
+    connect(_plugins,
+            SIGNAL(batchFinished(bool)),
+            this,
+            SLOT(handleBatchFinished(bool)));
+    connect(_plugins,
+            SIGNAL(pendingPluginFinished(QString,bool,bool,QString)),
+            this,
+            SLOT(handlePendingPluginFinished(QString,bool,bool,QString)));
+    connect(_plugins->getTrash(),
+            SIGNAL(reaped()),
+            this,
+            SLOT(handleTrashReaped()));
 }
 
 void NatronPluginManager::setupMenu()
@@ -315,6 +337,60 @@ void NatronPluginManager::setupMenu()
             this,
             SLOT(close()));
 
+    const auto pluginsMenu = new QMenu(tr("Plug-ins"), this);
+    _menuBar->addMenu(pluginsMenu);
+
+    const auto installSelectedAction = new QAction(tr("Install selected"), this);
+    installSelectedAction->setShortcut(QKeySequence(tr("Ctrl+I")));
+    pluginsMenu->addAction(installSelectedAction);
+    connect(installSelectedAction,
+            SIGNAL(triggered()),
+            this,
+            SLOT(installSelectedPlugins()));
+
+    const auto updateSelectedAction = new QAction(tr("Update selected"), this);
+    pluginsMenu->addAction(updateSelectedAction);
+    connect(updateSelectedAction,
+            SIGNAL(triggered()),
+            this,
+            SLOT(updateSelectedPlugins()));
+
+    const auto removeSelectedAction = new QAction(tr("Remove selected"), this);
+    pluginsMenu->addAction(removeSelectedAction);
+    connect(removeSelectedAction,
+            SIGNAL(triggered()),
+            this,
+            SLOT(removeSelectedPlugins()));
+
+    pluginsMenu->addSeparator();
+
+    const auto updateAllAction = new QAction(tr("Update all"), this);
+    updateAllAction->setShortcut(QKeySequence(tr("Ctrl+U")));
+    pluginsMenu->addAction(updateAllAction);
+    connect(updateAllAction,
+            SIGNAL(triggered()),
+            this,
+            SLOT(updateAllPlugins()));
+
+    pluginsMenu->addSeparator();
+
+    _cancelAction = new QAction(tr("Cancel"), this);
+    _cancelAction->setEnabled(false);
+    pluginsMenu->addAction(_cancelAction);
+    connect(_cancelAction,
+            SIGNAL(triggered()),
+            this,
+            SLOT(cancelPlugins()));
+
+    _undoAction = new QAction(tr("Undo remove"), this);
+    _undoAction->setShortcut(QKeySequence(tr("Ctrl+Z")));
+    _undoAction->setEnabled(false);
+    pluginsMenu->addAction(_undoAction);
+    connect(_undoAction,
+            SIGNAL(triggered()),
+            this,
+            SLOT(undoRemovePlugins()));
+
     const auto helpMenu = new QMenu(tr("Help"), this);
     _menuBar->addMenu(helpMenu);
 
@@ -380,6 +456,7 @@ void NatronPluginManager::setupPluginList()
     _pluginList->setGridSize(getConfigPluginGridSize());
     _pluginList->setResizeMode(QListView::Adjust);
     _pluginList->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    _pluginList->setSelectionMode(QAbstractItemView::ExtendedSelection);
 
     _pluginView = new PluginViewWidget(this,
                                        _plugins,
@@ -482,11 +559,33 @@ void NatronPluginManager::handleUpdatedPlugins()
     updateFilterPlugins();
 }
 
-void NatronPluginManager::updatePluginStatusLabels()
+void NatronPluginManager::handleUpdatedPlugin(const QString &id,
+                                              int type)
+{
+    // a single plug-in moved, leave the rest of the list alone
+    emit pluginStatusChanged(id, type);
+    for (int i = 0; i < _pluginList->count(); ++i) {
+        const auto item = _pluginList->item(i);
+        if (item->data(PLUGIN_LIST_ROLE_ID).toString() != id) { continue; }
+        filterPlugin(item,
+                     _comboStatus->currentText(),
+                     _comboGroup->currentText(),
+                     _lineEdit->text());
+        break;
+    }
+    updatePluginCountLabels();
+}
+
+void NatronPluginManager::updatePluginCountLabels()
 {
     _availableLabel->setText(QString::number(_plugins->getAvailablePlugins().size()));
     _installedLabel->setText(QString::number(_plugins->getInstalledPlugins().size()));
     _updatesLabel->setText(QString::number(_plugins->getUpdatedPlugins().size()));
+}
+
+void NatronPluginManager::updatePluginStatusLabels()
+{
+    updatePluginCountLabels();
 
     const auto locale = this->locale();
     _cacheLabel->setText(locale.formattedDataSize(_plugins->getCacheSize()));
@@ -532,12 +631,15 @@ void NatronPluginManager::handleDownloadStatusMessage(const QString &message,
                                                       qint64 value,
                                                       qint64 total)
 {
-    qDebug() << message << value << total;
+    // updates are already rate limited by Plugins, avoid redundant work here
+    if (value == total) {
+        if (_progBar->isVisible()) { _progBar->hide(); }
+        return;
+    }
     if (_progBar->isHidden()) { _progBar->show(); }
     _statusBar->showMessage(message, 2000);
-    _progBar->setRange(0, total);
+    if (_progBar->maximum() != total) { _progBar->setRange(0, total); }
     _progBar->setValue(value);
-    if (value == total && _progBar->isVisible()) { _progBar->hide(); }
 }
 
 void NatronPluginManager::populatePlugins()
@@ -559,7 +661,7 @@ void NatronPluginManager::populatePlugins()
     for (unsigned long i = 0; i< plugins.size(); ++i) {
         const auto item = new QListWidgetItem(); // the list takes ownership
         const auto plugin = plugins.at(i);
-        item->setFlags(Qt::NoItemFlags);
+        item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
         item->setData(PLUGIN_LIST_ROLE_GROUP, plugin.group);
         item->setData(PLUGIN_LIST_ROLE_ID, plugin.id);
         Plugins::PluginType type = Plugins::NATRON_PLUGIN_TYPE_NONE;
@@ -573,7 +675,8 @@ void NatronPluginManager::populatePlugins()
         const auto pwidget = new PluginListWidget(plugin,
                                                   type,
                                                   _pluginList->gridSize(),
-                                                  getConfigPluginIconSize()); // the list takes ownership
+                                                  getConfigPluginIconSize(),
+                                                  _plugins->getImageCache()); // the list takes ownership
         connect(pwidget,
                 SIGNAL(pluginButtonReleased(QString,int)),
                 this,
@@ -586,6 +689,11 @@ void NatronPluginManager::populatePlugins()
                 SIGNAL(showPlugin(QString)),
                 this,
                 SLOT(showPlugin(QString)));
+        connect(this,
+                SIGNAL(pluginBusyChanged(QString,bool)),
+                pwidget,
+                SLOT(setPluginBusy(QString,bool)));
+        if (_busyPlugins.contains(plugin.id)) { pwidget->setPluginBusy(plugin.id, true); }
 
         item->setSizeHint(_pluginList->gridSize());
         _pluginList->addItem(item);
@@ -618,30 +726,38 @@ void NatronPluginManager::filterPlugins(const QString &status,
                                         const QString &filter)
 {
     for (int i = 0; i < _pluginList->count(); ++i) {
-        const auto item = _pluginList->item(i);
-        const QString itemId = item->data(PLUGIN_LIST_ROLE_ID).toString();
-        const QString itemGroup = item->data(PLUGIN_LIST_ROLE_GROUP).toString();
-        bool visible = true;
-        if (status == tr("Available")) {
-            visible = _plugins->hasAvailablePlugin(itemId);
-        } else if (status == tr("Installed")) {
-            visible = _plugins->hasInstalledPlugin(itemId);
-        } else if (status == tr("Updates")) {
-            visible = _plugins->hasUpdatedPlugin(itemId);
-        }
-        if (!group.isEmpty()) {
-            bool hasGroup = (itemGroup == group || group == tr("All"));
-            if (visible && !hasGroup) { visible = false; }
-        }
-        if (!filter.isEmpty()) {
-            bool isMatch = _plugins->getPlugin(itemId).label.startsWith(filter,
-                                                                        Qt::CaseInsensitive);
-            if (!isMatch && visible) { visible = false; }
-        }
-        item->setHidden(!visible);
+        filterPlugin(_pluginList->item(i), status, group, filter);
     }
 }
 
+void NatronPluginManager::filterPlugin(QListWidgetItem *item,
+                                       const QString &status,
+                                       const QString &group,
+                                       const QString &filter)
+{
+    if (!item) { return; }
+    const QString itemId = item->data(PLUGIN_LIST_ROLE_ID).toString();
+    const QString itemGroup = item->data(PLUGIN_LIST_ROLE_GROUP).toString();
+    bool visible = true;
+    if (status == tr("Available")) {
+        visible = _plugins->hasAvailablePlugin(itemId);
+    } else if (status == tr("Installed")) {
+        visible = _plugins->hasInstalledPlugin(itemId);
+    } else if (status == tr("Updates")) {
+        visible = _plugins->hasUpdatedPlugin(itemId);
+    }
+    if (!group.isEmpty()) {
+        bool hasGroup = (itemGroup == group || group == tr("All"));
+        if (visible && !hasGroup) { visible = false; }
+    }
+    if (!filter.isEmpty()) {
+        bool isMatch = _plugins->getPlugin(itemId).label.startsWith(filter,
+                                                                    Qt::CaseInsensitive);
+        if (!isMatch && visible) { visible = false; }
+    }
+    item->setHidden(!visible);
+}
+
 void NatronPluginManager::handlePluginButtonReleased(const QString &id,
                                                      int type)
 {
@@ -662,81 +778,197 @@ void NatronPluginManager::handlePluginButtonReleased(const QString &id,
 
 void NatronPluginManager::installPlugin(const QString &id)
 {
-    const auto status = _plugins->installPlugin(id);
-    if (!status.success) {
-        QMessageBox::warning(this, tr("Install"), status.message);
-    } else {
-        emit pluginStatusChanged(id, Plugins::NATRON_PLUGIN_TYPE_INSTALLED);
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-        QFuture f = QtConcurrent::run(
-                                      &Plugins::checkRepositories,
-                                      _plugins,
-#else
-        QtConcurrent::run(
-                                      _plugins,
-                                      &Plugins::checkRepositories,
-#endif
-                                      false,
-                                      true);
-    }
+    Plugins::BatchSpecs item;
+    item.id = id;
+    item.type = Plugins::NATRON_PLUGIN_TYPE_AVAILABLE;
+    runBatch(std::vector<Plugins::BatchSpecs>(1, item), tr("Install"));
 }
 
 void NatronPluginManager::removePlugin(const QString &id)
 {
-    const auto status = _plugins->removePlugin(id);
-    if (!status.success) {
-        QMessageBox::warning(this, tr("Remove"), status.message);
-    } else {
-        emit pluginStatusChanged(id, Plugins::NATRON_PLUGIN_TYPE_AVAILABLE);
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-        QFuture f = QtConcurrent::run(
-                                      &Plugins::checkRepositories,
-                                      _plugins,
-#else
-        QtConcurrent::run(
-                                      _plugins,
-                                      &Plugins::checkRepositories,
-#endif
-                                      false,
-                                      true);
-    }
+    Plugins::BatchSpecs item;
+    item.id = id;
+    item.type = Plugins::NATRON_PLUGIN_TYPE_INSTALLED;
+    runBatch(std::vector<Plugins::BatchSpecs>(1, item), tr("Remove"));
 }
 
 void NatronPluginManager::updatePlugin(const QString &id)
 {
-    const auto status = _plugins->updatePlugin(id);
-    if (!status.success) {
-        QMessageBox::warning(this, tr("Update"), status.message);
-    } else {
-        emit pluginStatusChanged(id, Plugins::NATRON_PLUGIN_TYPE_INSTALLED);
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-        QFuture f = QtConcurrent::run(
-                                     &Plugins::checkRepositories,
-                                     _plugins,
-#else
-        QtConcurrent::run(
-                                     _plugins,
-                                      &Plugins::checkRepositories,
-#endif
-                                      false,
-                                      true);
+    Plugins::BatchSpecs item;
+    item.id = id;
+    item.type = Plugins::NATRON_PLUGIN_TYPE_UPDATE;
+    runBatch(std::vector<Plugins::BatchSpecs>(1, item), tr("Update"));
+}
+
+void NatronPluginManager::installSelectedPlugins()
+{
+    runBatch(getSelectedPlugins(Plugins::NATRON_PLUGIN_TYPE_AVAILABLE), tr("Install"));
+}
+
+void NatronPluginManager::removeSelectedPlugins()
+{
+    runBatch(getSelectedPlugins(Plugins::NATRON_PLUGIN_TYPE_INSTALLED), tr("Remove"));
+}
+
+void NatronPluginManager::updateSelectedPlugins()
+{
+    runBatch(getSelectedPlugins(Plugins::NATRON_PLUGIN_TYPE_UPDATE), tr("Update"));
+}
+
+void NatronPluginManager::updateAllPlugins()
+{
+    std::vector<Plugins::BatchSpecs> batch;
+    const auto plugins = _plugins->getUpdatedPlugins();
+    for (unsigned long i = 0; i < plugins.size(); ++i) {
+        Plugins::BatchSpecs item;
+        item.id = plugins.at(i).id;
+        item.type = Plugins::NATRON_PLUGIN_TYPE_UPDATE;
+        batch.push_back(item);
+    }
+    runBatch(batch, tr("Update"));
+}
+
+std::vector<Plugins::BatchSpecs> NatronPluginManager::getSelectedPlugins(Plugins::PluginType type)
+{
+    std::vector<Plugins::BatchSpecs> batch;
+    const auto items = _pluginList->selectedItems();
+    for (int i = 0; i < items.size(); ++i) {
+        if (items.at(i)->isHidden()) { continue; }
+        const QString id = items.at(i)->data(PLUGIN_LIST_ROLE_ID).toString();
+        bool match = false;
+        switch (type) {
+        case Plugins::NATRON_PLUGIN_TYPE_AVAILABLE:
+            match = _plugins->hasAvailablePlugin(id);
+            break;
+        case Plugins::NATRON_PLUGIN_TYPE_INSTALLED:
+            match = _plugins->hasInstalledPlugin(id);
+            break;
+        case Plugins::NATRON_PLUGIN_TYPE_UPDATE:
+            match = _plugins->hasUpdatedPlugin(id);
+            break;
+        default:;
+        }
+        if (!match) { continue; }
+        Plugins::BatchSpecs item;
+        item.id = id;
+        item.type = type;
+        batch.push_back(item);
+    }
+    return batch;
+}
+
+void NatronPluginManager::runBatch(const std::vector<Plugins::BatchSpecs> &batch,
+                                   const QString &title)
+{
+    if (batch.size() < 1) { return; }
+    if (!_plugins->startBatch(batch)) { // runs in the background, rescans once when done
+        _statusBar->showMessage(tr("Busy, please wait for the current operation to finish"), 2000);
+        return;
+    }
+    _batchTitle = title;
+    _batchErrors.clear();
+    _removedPlugins.clear();
+    _cancelAction->setEnabled(true);
+    for (unsigned long i = 0; i < batch.size(); ++i) {
+        _busyPlugins << batch.at(i).id;
+        emit pluginBusyChanged(batch.at(i).id, true);
     }
 }
 
+void NatronPluginManager::cancelPlugins()
+{
+    _plugins->cancelBatch();
+}
+
+void NatronPluginManager::handleBatchItemFinished(const QString &id,
+                                                  int type,
+                                                  bool success,
+                                                  bool pending,
+                                                  const QString &message)
+{
+    _busyPlugins.removeAll(id);
+    emit pluginBusyChanged(id, false);
+    // the new status comes from Plugins::updatedPlugin
+    if (pending) {
+        _statusBar->showMessage(message, 2000);
+    } else if (!success && !message.isEmpty()) { // empty if cancelled
+        _batchErrors << message;
+    } else if (success && type == Plugins::NATRON_PLUGIN_TYPE_INSTALLED) {
+        _removedPlugins << id;
+    }
+}
+
+void NatronPluginManager::handleBatchFinished(bool cancelled)
+{
+    _cancelAction->setEnabled(false);
+    if (cancelled) { _statusBar->showMessage(tr("Cancelled"), 2000); }
+    if (_batchErrors.size() > 0) { QMessageBox::warning(this, _batchTitle, _batchErrors.join("\n")); }
+    _batchErrors.clear();
+    if (_removedPlugins.size() > 0) { // still in the trash, can be undone until it's emptied
+        _undoPlugins = _removedPlugins;
+        _removedPlugins.clear();
+        _undoAction->setEnabled(true);
+    }
+}
+
+void NatronPluginManager::undoRemovePlugins()
+{
+    if (_undoPlugins.size() < 1) { return; }
+    if (_plugins->isBatchRunning()) {
+        _statusBar->showMessage(tr("Busy, please wait for the current operation to finish"), 2000);
+        return;
+    }
+    QStringList errors;
+    for (int i = 0; i < _undoPlugins.size(); ++i) {
+        Plugins::PluginStatus status = _plugins->restorePlugin(_undoPlugins.at(i));
+        if (!status.success) { errors << status.message; }
+    }
+    _undoPlugins.clear();
+    _undoAction->setEnabled(false);
+    if (errors.size() > 0) { QMessageBox::warning(this, tr("Undo remove"), errors.join("\n")); }
+}
+
+void NatronPluginManager::handleTrashReaped()
+{
+    _undoPlugins.clear();
+    _undoAction->setEnabled(false);
+}
+
+void NatronPluginManager::handlePendingPluginFinished(const QString &id,
+                                                      bool update,
+                                                      bool success,
+                                                      const QString &message)
+{
+    Q_UNUSED(id)
+    if (!success) { QMessageBox::warning(this, update ? tr("Update") : tr("Install"), message); }
+}
+
 void NatronPluginManager::openAddRepoDialog()
 {
+    if (_plugins->isBusy()) {
+        _statusBar->showMessage(tr("Busy, please wait for the current operation to finish"), 2000);
+        return;
+    }
     AddRepoDialog dialog(this, _plugins);
     dialog.exec();
 }
 
 void NatronPluginManager::openSettingsDialog()
 {
+    if (_plugins->isBusy()) { // paths and install options must not change under a running operation
+        _statusBar->showMessage(tr("Busy, please wait for the current operation to finish"), 2000);
+        return;
+    }
     SettingsDialog dialog(this, _plugins);
     if (dialog.exec() == QDialog::Accepted) { updateSettings(); }
 }
 
 void NatronPluginManager::updateSettings()
 {
+    if (_plugins->isBusy()) {
+        _statusBar->showMessage(tr("Busy, settings are applied on the next refresh"), 2000);
+        return;
+    }
     _plugins->checkRepositories();
 }
 
@@ -34,6 +34,8 @@
 #include <QProgressBar>
 #include <QLabel>
 #include <QLineEdit>
+#include <QAction>
+#include <QStringList>
 
 #include "plugins.h"
 #include "pluginviewwidget.h"
@@ -66,6 +68,8 @@ signals:
 
     void pluginStatusChanged(const QString &id,
                              int type);
+    void pluginBusyChanged(const QString &id,
+                           bool busy);
 
 private:
 
@@ -85,6 +89,17 @@ private:
     QLabel *_installedLabel;
     QLabel *_updatesLabel;
     QLabel *_cacheLabel;
+    QAction *_cancelAction;
+    QAction *_undoAction;
+    QStringList _busyPlugins;
+    QStringList _removedPlugins; // by the running batch
+    QStringList _undoPlugins; // by the last batch, until the trash is emptied
+    QStringList _batchErrors;
+    QString _batchTitle;
+
+    std::vector<Plugins::BatchSpecs> getSelectedPlugins(Plugins::PluginType type);
+    void runBatch(const std::vector<Plugins::BatchSpecs> &batch,
+                  const QString &title);
 
 private slots:
 
@@ -97,6 +112,9 @@ private slots:
 
     void startup();
     void handleUpdatedPlugins();
+    void handleUpdatedPlugin(const QString &id,
+                             int type);
+    void updatePluginCountLabels();
     void updatePluginStatusLabels();
     void handleAboutActionTriggered();
     void handleAboutQtActionTriggered();
@@ -114,6 +132,10 @@ private slots:
     void filterPlugins(const QString &status,
                        const QString &group,
                        const QString &filter = QString());
+    void filterPlugin(QListWidgetItem *item,
+                      const QString &status,
+                      const QString &group,
+                      const QString &filter = QString());
 
     void handlePluginButtonReleased(const QString &id,
                                     int type);
@@ -121,6 +143,23 @@ private slots:
     void installPlugin(const QString &id);
     void removePlugin(const QString &id);
     void updatePlugin(const QString &id);
+    void installSelectedPlugins();
+    void removeSelectedPlugins();
+    void updateSelectedPlugins();
+    void updateAllPlugins();
+    void cancelPlugins();
+    void handleBatchItemFinished(const QString &id,
+                                 int type,
+                                 bool success,
+                                 bool pending,
+                                 const QString &message);
+    void handleBatchFinished(bool cancelled);
+    void undoRemovePlugins();
+    void handleTrashReaped();
+    void handlePendingPluginFinished(const QString &id,
+                                     bool update,
+                                     bool success,
+                                     const QString &message);
 
     void openAddRepoDialog();
     void openSettingsDialog();
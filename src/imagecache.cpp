@@ -0,0 +1,213 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+#include "imagecache.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QDir>
+#include <QImageReader>
+#include <QNetworkRequest>
+#include <QCryptographicHash>
+#include <QSettings>
+#include <QtConcurrentRun>
+
+ImageCache::ImageCache(const QString &path,
+                       QObject *parent)
+    : QObject(parent)
+    , _path(path)
+    , _nam(nullptr)
+{
+    _images.setMaxCost(IMAGECACHE_MEMORY_LIMIT);
+    if (!_path.isEmpty() && !QFile::exists(_path)) {
+        QDir dir;
+        dir.mkpath(_path);
+    }
+
+    _nam = new QNetworkAccessManager(this);
+    connect(_nam,
+            SIGNAL(finished(QNetworkReply*)),
+            this,
+            SLOT(handleImageDownloaded(QNetworkReply*)));
+    connect(this,
+            SIGNAL(imageDecoded(QString,QUrl,QImage)),
+            this,
+            SLOT(handleImageDecoded(QString,QUrl,QImage)),
+            Qt::QueuedConnection);
+}
+
+QPixmap ImageCache::getPixmap(const QUrl &url,
+                              const QSize &size)
+{
+    QImage *image = _images.object(getKey(url, size));
+    if (!image) { return QPixmap(); }
+    return QPixmap::fromImage(*image);
+}
+
+const QString ImageCache::getImagePath(const QUrl &url)
+{
+    if (url.isEmpty()) { return QString(); }
+    if (url.isLocalFile()) { return url.toLocalFile(); }
+    QByteArray hash = QCryptographicHash::hash(url.toString().toUtf8(),
+                                               QCryptographicHash::Sha1);
+    return QString("%1/%2").arg(_path, QString::fromLatin1(hash.toHex()));
+}
+
+bool ImageCache::insert(const QUrl &url,
+                        const QByteArray &data)
+{
+    QString filename = getImagePath(url);
+    if (filename.isEmpty() || url.isLocalFile() || data.isEmpty()) { return false; }
+
+    // write next to the old image and replace it when complete
+    QString partPath = QString("%1.part").arg(filename);
+    QFile part(partPath);
+    if (!part.open(QIODevice::WriteOnly | QIODevice::Truncate)) { return false; }
+    bool written = part.write(data) == data.size();
+    part.close();
+    if (written) {
+        QFile::remove(filename);
+        written = QFile::rename(partPath, filename);
+    }
+    if (!written) {
+        QFile::remove(partPath);
+        return false;
+    }
+
+    // decode again for everyone using the image
+    QList<QSize> sizes = _sizes.value(url.toString());
+    for (int i = 0; i < sizes.size(); ++i) {
+        _images.remove(getKey(url, sizes.at(i)));
+        decode(url, sizes.at(i));
+    }
+    emit imageReady(url);
+    return true;
+}
+
+void ImageCache::request(const QUrl &url,
+                         const QSize &size)
+{
+    if (url.isEmpty() || !url.isValid()) { return; }
+    if (size.isValid()) {
+        QList<QSize> &sizes = _sizes[url.toString()];
+        if (!sizes.contains(size)) { sizes.append(size); }
+        if (!_images.contains(getKey(url, size)) &&
+            QFile::exists(getImagePath(url))) { decode(url, size); }
+    }
+    if (!url.isLocalFile()) { download(url); }
+}
+
+const QString ImageCache::getKey(const QUrl &url,
+                                 const QSize &size)
+{
+    return QString("%1@%2x%3").arg(url.toString()).arg(size.width()).arg(size.height());
+}
+
+void ImageCache::decode(const QUrl &url,
+                        const QSize &size)
+{
+    QString key = getKey(url, size);
+    if (_decoding.contains(key)) { return; }
+    _decoding << key;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QFuture f = QtConcurrent::run(&ImageCache::decodeImage,
+                                  this,
+#else
+    QtConcurrent::run(this,
+                      &ImageCache::decodeImage,
+#endif
+                      key,
+                      url,
+                      getImagePath(url),
+                      size);
+}
+
+void ImageCache::decodeImage(const QString &key,
+                             const QUrl &url,
+                             const QString &filename,
+                             const QSize &size)
+{
+    QImageReader reader(filename);
+    QSize imageSize = reader.size();
+    if (imageSize.isValid()) { // let the decoder scale if it can
+        reader.setScaledSize(imageSize.scaled(size, Qt::KeepAspectRatio));
+    }
+    QImage image = reader.read();
+    if (!image.isNull() && image.size() != size) {
+        image = image.scaled(size,
+                             Qt::KeepAspectRatio,
+                             Qt::SmoothTransformation);
+    }
+    emit imageDecoded(key, url, image);
+}
+
+void ImageCache::download(const QUrl &url)
+{
+    // once per session, revalidate if we already have it
+    if (_downloading.contains(url.toString()) ||
+        _validated.contains(url.toString())) { return; }
+    _downloading << url.toString();
+
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                         QNetworkRequest::NoLessSafeRedirectPolicy);
+    if (QFile::exists(getImagePath(url))) {
+        QSettings meta(QString("%1.meta").arg(getImagePath(url)), QSettings::IniFormat);
+        QByteArray etag = meta.value("ETag").toByteArray();
+        QByteArray modified = meta.value("Last-Modified").toByteArray();
+        if (!etag.isEmpty()) { request.setRawHeader("If-None-Match", etag); }
+        if (!modified.isEmpty()) { request.setRawHeader("If-Modified-Since", modified); }
+    }
+    _nam->get(request);
+}
+
+void ImageCache::handleImageDecoded(const QString &key,
+                                    const QUrl &url,
+                                    const QImage &image)
+{
+    _decoding.removeAll(key);
+    if (image.isNull()) {
+        qWarning() << "Unable to decode image" << url;
+        return;
+    }
+    int cost = int(image.sizeInBytes() / 1024);
+    _images.insert(key, new QImage(image), qMax(1, cost));
+    emit imageReady(url);
+}
+
+void ImageCache::handleImageDownloaded(QNetworkReply *reply)
+{
+    if (!reply) { return; }
+    QUrl url = reply->request().url();
+    _downloading.removeAll(url.toString());
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (reply->error() != QNetworkReply::NoError) {
+        qWarning() << "Unable to download image" << url << reply->errorString();
+    } else if (status == 304) { // not modified
+        _validated << url.toString();
+    } else if (insert(url, reply->readAll())) {
+        _validated << url.toString();
+        QSettings meta(QString("%1.meta").arg(getImagePath(url)), QSettings::IniFormat);
+        meta.setValue("ETag", reply->rawHeader("ETag"));
+        meta.setValue("Last-Modified", reply->rawHeader("Last-Modified"));
+    }
+    reply->deleteLater();
+}
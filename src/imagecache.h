@@ -0,0 +1,96 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QSize>
+#include <QHash>
+#include <QList>
+#include <QCache>
+#include <QImage>
+#include <QPixmap>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+// max size (KB) of decoded images kept in memory
+#define IMAGECACHE_MEMORY_LIMIT 32768
+
+class ImageCache : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit ImageCache(const QString &path,
+                        QObject *parent = nullptr);
+
+    QPixmap getPixmap(const QUrl &url,
+                      const QSize &size);
+    const QString getImagePath(const QUrl &url);
+    bool insert(const QUrl &url,
+                const QByteArray &data);
+
+signals:
+
+    void imageReady(const QUrl &url);
+    void imageDecoded(const QString &key,
+                      const QUrl &url,
+                      const QImage &image);
+
+public slots:
+
+    void request(const QUrl &url,
+                 const QSize &size = QSize());
+
+private:
+
+    QString _path;
+    QNetworkAccessManager *_nam;
+    QCache<QString, QImage> _images;
+    QHash<QString, QList<QSize> > _sizes; // url, requested sizes
+    QStringList _decoding;
+    QStringList _downloading;
+    QStringList _validated;
+
+    const QString getKey(const QUrl &url,
+                         const QSize &size);
+    void decode(const QUrl &url,
+                const QSize &size);
+    void decodeImage(const QString &key,
+                     const QUrl &url,
+                     const QString &filename,
+                     const QSize &size);
+    void download(const QUrl &url);
+
+private slots:
+
+    void handleImageDecoded(const QString &key,
+                            const QUrl &url,
+                            const QImage &image);
+    void handleImageDownloaded(QNetworkReply *reply);
+};
+
+#endif // IMAGECACHE_H
@@ -0,0 +1,175 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+#include "objectstore.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QCryptographicHash>
+#include <QtConcurrentMap>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+ObjectStore::ObjectStore(const QString &path,
+                         QObject *parent)
+    : QObject(parent)
+    , _path(path)
+{
+}
+
+bool ObjectStore::isSupported()
+{
+#ifdef Q_OS_UNIX
+    return true;
+#else
+    return false; // no hardlinks we can rely on
+#endif
+}
+
+const QString ObjectStore::getPath()
+{
+    return _path;
+}
+
+const QString ObjectStore::getObjectPath(const QString &hash)
+{
+    if (_path.isEmpty() || hash.size() <= OBJECTSTORE_PREFIX) { return QString(); }
+    return QString("%1/%2/%3").arg(_path, hash.left(OBJECTSTORE_PREFIX), hash);
+}
+
+const QString ObjectStore::add(const QString &filename)
+{
+#ifdef Q_OS_UNIX
+    QFile input(filename);
+    QCryptographicHash sha(QCryptographicHash::Sha256);
+    if (!input.open(QIODevice::ReadOnly) || !sha.addData(&input)) { return QString(); }
+    input.close();
+    QString hash = QString::fromLatin1(sha.result().toHex());
+    QString object = getObjectPath(hash);
+    if (object.isEmpty()) { return QString(); }
+
+    QDir dir;
+    dir.mkpath(QFileInfo(object).absolutePath());
+
+    // first copy becomes the object, read-only so it can't be changed through any of its links
+    if (::link(QFile::encodeName(filename).constData(),
+               QFile::encodeName(object).constData()) == 0)
+    {
+        QFile::setPermissions(object, QFile::ReadOwner | QFile::ReadUser | QFile::ReadGroup | QFile::ReadOther);
+        return hash;
+    }
+    if (errno != EEXIST) { return QString(); } // other filesystem etc
+
+    // already stored, replace the file with a link to the object
+    QString temp = QString("%1.link").arg(filename);
+    QFile::remove(temp);
+    if (::link(QFile::encodeName(object).constData(),
+               QFile::encodeName(temp).constData()) != 0) { return QString(); }
+    if (::rename(QFile::encodeName(temp).constData(),
+                 QFile::encodeName(filename).constData()) != 0)
+    {
+        QFile::remove(temp);
+        return QString();
+    }
+    return hash;
+#else
+    Q_UNUSED(filename)
+    return QString();
+#endif
+}
+
+int ObjectStore::addFiles(const QStringList &filenames)
+{
+    if (!isSupported()) { return 0; }
+    QStringList files = filenames;
+
+    // hashing is the expensive part, spread it across the pool
+    QtConcurrent::blockingMap(files, [this](QString &file) { file = add(file); });
+
+    int added = 0;
+    for (int i = 0; i < files.size(); ++i) {
+        if (!files.at(i).isEmpty()) { added++; }
+    }
+    return added;
+}
+
+bool ObjectStore::clone(const QString &filename,
+                        const QString &dest)
+{
+    if (QFile::exists(dest)) { return false; }
+#ifdef Q_OS_LINUX
+#ifdef FICLONE
+    // a reflink shares the data but stays an independent (writable) file
+    int in = ::open(QFile::encodeName(filename).constData(), O_RDONLY);
+    if (in >= 0) {
+        int out = ::open(QFile::encodeName(dest).constData(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        bool cloned = false;
+        if (out >= 0) {
+            cloned = ioctl(out, FICLONE, in) == 0;
+            ::close(out);
+            if (!cloned) { QFile::remove(dest); }
+        }
+        ::close(in);
+        if (cloned) { return true; }
+    }
+#endif
+#endif
+    // never a hardlink, installs must not share the read-only object
+    if (!QFile::copy(filename, dest)) { return false; }
+    return QFile::setPermissions(dest, QFile::permissions(dest) | QFile::WriteOwner | QFile::WriteUser);
+}
+
+int ObjectStore::prune()
+{
+    int removed = 0;
+#ifdef Q_OS_UNIX
+    if (_path.isEmpty() || !QFile::exists(_path)) { return removed; }
+
+    // objects only linked from the store are no longer used
+    QDirIterator it(_path,
+                    QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot | QDir::NoSymLinks,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString object = it.next();
+        struct stat st;
+        if (lstat(QFile::encodeName(object).constData(), &st) != 0) { continue; }
+        if (st.st_nlink == 1 && QFile::remove(object)) { removed++; }
+    }
+
+    QDir store(_path);
+    QStringList prefixes = store.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (int i = 0; i < prefixes.size(); ++i) { store.rmdir(prefixes.at(i)); } // only if empty
+#endif
+    return removed;
+}
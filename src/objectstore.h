@@ -0,0 +1,55 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+#ifndef OBJECTSTORE_H
+#define OBJECTSTORE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+// prefix length of the folders objects are spread across
+#define OBJECTSTORE_PREFIX 2
+
+class ObjectStore : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit ObjectStore(const QString &path,
+                         QObject *parent = nullptr);
+
+    static bool isSupported();
+    const QString getPath();
+    const QString getObjectPath(const QString &hash);
+    const QString add(const QString &filename);
+    int addFiles(const QStringList &filenames);
+    bool clone(const QString &filename,
+               const QString &dest);
+    int prune();
+
+private:
+
+    QString _path;
+};
+
+#endif // OBJECTSTORE_H
@@ -32,12 +32,18 @@ PluginListWidget::PluginListWidget(const Plugins::PluginSpecs &plugin,
                                    Plugins::PluginType type,
                                    QSize widgetSize,
                                    QSize iconSize,
+                                   ImageCache *images,
                                    QWidget *parent)
     : QWidget(parent)
     , _plugin(plugin)
+    , _images(images)
+    , _iconLabel(nullptr)
+    , _iconSize(iconSize)
     , _installButton(nullptr)
     , _removeButton(nullptr)
     , _updateButton(nullptr)
+    , _busyLabel(nullptr)
+    , _type(type)
 {
     setFixedSize(widgetSize);
 
@@ -61,7 +67,7 @@ PluginListWidget::PluginListWidget(const Plugins::PluginSpecs &plugin,
 
     const auto pluginTitleLabel = new QLabel(_plugin.label, this);
     const auto pluginGroupLabel = new QLabel(_plugin.group, this);
-    const auto pluginIconLabel = new QLabel(this);
+    _iconLabel = new QLabel(this);
 
     pluginTitleLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     pluginGroupLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
@@ -69,19 +75,28 @@ PluginListWidget::PluginListWidget(const Plugins::PluginSpecs &plugin,
     pluginTitleLabel->setProperty("TitleLabel", true);
     pluginGroupLabel->setProperty("GroupLabel", true);
 
-    pluginIconLabel->setMinimumSize(iconSize);
-    pluginIconLabel->setMaximumSize(iconSize);
+    _iconLabel->setMinimumSize(iconSize);
+    _iconLabel->setMaximumSize(iconSize);
 
-    pluginIconLabel->setPixmap(QIcon(QString(DEFAULT_ICON)).pixmap(iconSize).scaled(iconSize,
-                                                                                    Qt::KeepAspectRatio,
-                                                                                    Qt::SmoothTransformation));
+    _iconLabel->setPixmap(QIcon(QString(DEFAULT_ICON)).pixmap(iconSize).scaled(iconSize,
+                                                                               Qt::KeepAspectRatio,
+                                                                               Qt::SmoothTransformation));
 
     QString pluginIconPath = QString("%1/%2").arg(_plugin.path, _plugin.icon);
-    if (!_plugin.icon.isEmpty() && QFile::exists(pluginIconPath)) {
+    bool hasIconFile = !_plugin.icon.isEmpty() && QFile::exists(pluginIconPath);
+    _iconUrl = hasIconFile ? QUrl::fromLocalFile(pluginIconPath) : _plugin.iconUrl;
+    if (_images && !_iconUrl.isEmpty()) { // decoded and scaled in the background
+        connect(_images,
+                SIGNAL(imageReady(QUrl)),
+                this,
+                SLOT(handleImageReady(QUrl)));
+        handleImageReady(_iconUrl);
+        _images->request(_iconUrl, _iconSize);
+    } else if (hasIconFile) {
         QPixmap pluginPixmap = QIcon(pluginIconPath).pixmap(iconSize).scaled(iconSize,
                                                                              Qt::KeepAspectRatio,
                                                                              Qt::SmoothTransformation);
-        if (!pluginPixmap.isNull()) { pluginIconLabel->setPixmap(pluginPixmap); }
+        if (!pluginPixmap.isNull()) { _iconLabel->setPixmap(pluginPixmap); }
     }
 
     const auto pluginTypeLabel = new QLabel(this);
@@ -100,18 +115,23 @@ PluginListWidget::PluginListWidget(const Plugins::PluginSpecs &plugin,
     _removeButton->setProperty("RemoveButton", true);
     _updateButton->setProperty("UpdateButton", true);
 
+    _busyLabel = new QLabel(tr("Working ..."), this);
+    _busyLabel->setObjectName("PluginBusyLabel");
+    _busyLabel->setHidden(true);
+
     pluginsFooterLayout->addWidget(pluginTypeLabel);
     pluginsFooterLayout->addStretch();
     pluginsFooterLayout->addWidget(_updateButton);
     pluginsFooterLayout->addWidget(_installButton);
     pluginsFooterLayout->addWidget(_removeButton);
+    pluginsFooterLayout->addWidget(_busyLabel);
 
     pluginHeaderTextLayout->addStretch();
     pluginHeaderTextLayout->addWidget(pluginTitleLabel);
     pluginHeaderTextLayout->addWidget(pluginGroupLabel);
     pluginHeaderTextLayout->addStretch();
 
-    pluginHeaderLayout->addWidget(pluginIconLabel);
+    pluginHeaderLayout->addWidget(_iconLabel);
     pluginHeaderLayout->addWidget(pluginHeaderText);
 
     pluginFrameLayout->addWidget(pluginHeader);
@@ -143,6 +163,8 @@ void PluginListWidget::setPluginStatus(const QString &id,
                                        int type)
 {
     if (_plugin.id != id) { return; }
+    _type = type;
+    if (!_busyLabel->isHidden()) { return; } // applied when no longer busy
     switch(type) {
     case Plugins::NATRON_PLUGIN_TYPE_AVAILABLE:
         _installButton->setEnabled(true);
@@ -179,6 +201,18 @@ void PluginListWidget::setPluginStatus(const QString &id,
     }
 }
 
+void PluginListWidget::setPluginBusy(const QString &id,
+                                     bool busy)
+{
+    if (_plugin.id != id) { return; }
+    _busyLabel->setHidden(!busy);
+    if (busy) {
+        _installButton->setHidden(true);
+        _removeButton->setHidden(true);
+        _updateButton->setHidden(true);
+    } else { setPluginStatus(id, _type); }
+}
+
 void PluginListWidget::handleInstallButtonReleased()
 {
     emit pluginButtonReleased(_plugin.id,
@@ -197,8 +231,16 @@ void PluginListWidget::handleUpdateButtonReleased()
                               Plugins::NATRON_PLUGIN_TYPE_UPDATE);
 }
 
+void PluginListWidget::handleImageReady(const QUrl &url)
+{
+    if (!_images || url != _iconUrl) { return; }
+    QPixmap pluginPixmap = _images->getPixmap(url, _iconSize);
+    if (!pluginPixmap.isNull()) { _iconLabel->setPixmap(pluginPixmap); }
+}
+
 void PluginListWidget::mouseReleaseEvent(QMouseEvent *e)
 {
-    emit showPlugin(_plugin.id);
+    // ctrl/shift click is (multi) selection in the list
+    if (!(e->modifiers() & (Qt::ControlModifier | Qt::ShiftModifier))) { emit showPlugin(_plugin.id); }
     QWidget::mouseReleaseEvent(e);
 }
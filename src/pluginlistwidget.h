@@ -26,6 +26,8 @@
 #include <QSize>
 #include <QPushButton>
 #include <QMouseEvent>
+#include <QLabel>
+#include <QUrl>
 
 #include "plugins.h"
 
@@ -39,6 +41,7 @@ public:
                               Plugins::PluginType type,
                               QSize widgetSize,
                               QSize iconSize,
+                              ImageCache *images = nullptr,
                               QWidget *parent = nullptr);
    ~PluginListWidget();
 
@@ -52,19 +55,28 @@ public slots:
 
     void setPluginStatus(const QString &id,
                          int type);
+    void setPluginBusy(const QString &id,
+                       bool busy);
 
 private:
 
     Plugins::PluginSpecs _plugin;
+    ImageCache *_images;
+    QLabel *_iconLabel;
+    QSize _iconSize;
+    QUrl _iconUrl;
     QPushButton *_installButton;
     QPushButton *_removeButton;
     QPushButton *_updateButton;
+    QLabel *_busyLabel;
+    int _type;
 
 private slots:
 
     void handleInstallButtonReleased();
     void handleRemoveButtonReleased();
     void handleUpdateButtonReleased();
+    void handleImageReady(const QUrl &url);
 
 protected:
 
@@ -24,6 +24,7 @@
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
+#include <QDataStream>
 #include <QDir>
 #include <QDirIterator>
 #include <QTextStream>
@@ -32,8 +33,36 @@
 #include <QRandomGenerator>
 #include <QHash>
 #include <QHashIterator>
+#include <QSet>
 #include <QNetworkRequest>
 #include <QXmlStreamReader>
+#include <QTimer>
+#include <QLocale>
+#include <QBuffer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonParseError>
+#include <QCborStreamWriter>
+#include <QThread>
+#include <QThreadPool>
+#include <QFuture>
+#include <QtConcurrentRun>
+#include <QtConcurrentMap>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
 
 #include <zip.h>
 #define ZIP_BUF_SIZE 2048
@@ -51,8 +80,29 @@ Plugins::Plugins(QObject *parent)
     : QObject(parent)
     , _isWorking(false)
     , _isDownloading(false)
+    , _pendingRetries(0)
+    , _isBatch(0)
+    , _initGuiPending(0)
+    , _batchRunning(0)
+    , _batchCancel(0)
+    , _checkPending(false)
     , _nam(nullptr)
-{
+    , _progress(nullptr)
+    , _images(nullptr)
+    , _objects(nullptr)
+    , _trash(nullptr)
+{
+    _progress = new Progress(this);
+    connect(_progress,
+            SIGNAL(progress(QString,qint64,qint64)),
+            this,
+            SIGNAL(statusDownload(QString,qint64,qint64)));
+
+    _images = new ImageCache(getImageCachePath(), this);
+    _objects = new ObjectStore(getObjectStorePath(), this);
+    _trash = new Trash(getTrashPath(), this);
+    _batchPool.setMaxThreadCount(1); // batches and pending installs never overlap
+
     _nam = new QNetworkAccessManager(this);
     connect(_nam,
             SIGNAL(finished(QNetworkReply*)),
@@ -66,6 +116,8 @@ Plugins::Plugins(QObject *parent)
 
 Plugins::~Plugins()
 {
+    // the hashing jobs call back into us
+    for (int i = 0; i < _indexJobs.size(); ++i) { _indexJobs[i].waitForFinished(); }
     //saveRepositories(_availableRepositories);
 }
 
@@ -77,51 +129,251 @@ void Plugins::scanForAvailablePlugins(const RepoSpecs &repo,
 {
     if (!QFile::exists(path)) { return; }
     if (!append) {
+        _repoPlugins.clear();
         _availablePlugins.clear();
         _availablePluginUpdates.clear();
     }
+    std::vector<PluginSpecs> plugins = findPlugins(path, repo.label);
+    for (unsigned long i = 0; i < plugins.size(); ++i) {
+        PluginSpecs plugin = plugins.at(i);
+        plugin.repo = repo;
+        addAvailablePlugin(plugin);
+    }
+    if ((_availablePlugins.size() > 0 || _availablePluginUpdates.size() > 0) && emitChanges) { emit updatedPlugins(); }
+
+    if (emitCache) { emit updatedCache(); }
+}
+
+std::vector<Plugins::PluginSpecs> Plugins::findPlugins(const QString &path,
+                                                       const QString &label)
+{
+    // one walk, each folder is classified and parsed once, safe to run on any thread
+    std::vector<PluginSpecs> plugins;
+    if (!QFile::exists(path)) { return plugins; }
+    QString task = QString("scan:%1").arg(path);
+    _progress->start(task, tr("Scanning %1 ...").arg(label.isEmpty() ? path : label), false);
+    qint64 items = 0;
     QDirIterator it(path,
-                    QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks,
+                    QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks,
                     QDirIterator::Subdirectories);
     while (it.hasNext()) {
         QString item = it.next();
-        if (!folderHasPlugin(item) && !folderHasAddon(item)) { continue; }
-        PluginSpecs plugin = folderHasPlugin(item) ? getPluginSpecs(item) : folderHasAddon(item) ? getAddonSpecs(item) : PluginSpecs();
-        plugin.repo = repo;
-        if (!hasAvailablePlugin(plugin.id) &&
-            !hasInstalledPlugin(plugin.id))
-        {
-            _availablePlugins.push_back(plugin);
+        _progress->update(task, ++items, 0);
+        PluginSpecs plugin = getFolderSpecs(item);
+        if (!plugin.id.isEmpty()) { plugins.push_back(plugin); }
+    }
+    _progress->finish(task);
+    return plugins;
+}
+
+void Plugins::scanArchiveForAvailablePlugins(const RepoSpecs &repo,
+                                             bool emitChanges,
+                                             bool emitCache)
+{
+    QString filename = getRepoArchivePath(repo.id);
+    struct zip* p_zip = openArchive(filename, QByteArray());
+    if (p_zip == NULL) {
+        qWarning() << "Unable to open repository archive" << filename;
+        return;
+    }
+
+    // the central directory is all we need to find the plug-ins
+    QHash<QString, quint64> indexes;
+    zip_int64_t n_entries = zip_get_num_entries(p_zip, 0);
+    for (zip_int64_t entry_idx=0; entry_idx < n_entries; entry_idx++) {
+        struct zip_stat file_stat;
+        if (zip_stat_index(p_zip, entry_idx, 0, &file_stat)) { continue; }
+        if (!(file_stat.valid & ZIP_STAT_NAME) || file_stat.name[0] == '\0') { continue; }
+        indexes.insert(QString::fromUtf8(file_stat.name), entry_idx);
+    }
+    QStringList roots = getArchivePluginRoots(indexes.keys());
+
+    QString task = QString("scan:%1").arg(filename);
+    _progress->start(task, tr("Scanning %1 ...").arg(repo.label), false);
+    for (int i = 0; i < roots.size(); ++i) {
+        _progress->update(task, i, roots.size());
+        const QString &root = roots.at(i);
+        QString folder = root.section("/", -2, -2);
+        QString pyName = QString("%1%2.py").arg(root, folder);
+        QString readmeName = QString("%1README.md").arg(root);
+
+        // same order as the folder scan, plug-ins before add-ons
+        PluginSpecs plugin;
+        if (indexes.contains(pyName)) { parsePluginPy(plugin, readArchiveEntry(p_zip, indexes.value(pyName))); }
+        if (plugin.id.isEmpty()) {
+            plugin = PluginSpecs();
+            if (!indexes.contains(pyName) ||
+                !indexes.contains(QString("%1__init__.py").arg(root)) ||
+                !indexes.contains(readmeName)) { continue; }
+            plugin.desc = tr("No description");
+            plugin.isAddon = true;
+            parseAddonReadme(plugin, readArchiveEntry(p_zip, indexes.value(readmeName)));
+            if (plugin.id.isEmpty()) { continue; }
+        } else if (indexes.contains(readmeName)) {
+            plugin.readme = readArchiveEntry(p_zip, indexes.value(readmeName));
         }
-        if (hasInstalledPlugin(plugin.id) &&
-            plugin.version > getInstalledPlugin(plugin.id).version)
-        {
-            _availablePluginUpdates.push_back(plugin);
+        QString changesName = QString("%1CHANGES.md").arg(root);
+        if (indexes.contains(changesName)) { plugin.changes = readArchiveEntry(p_zip, indexes.value(changesName)); }
+        QString authorsName = QString("%1AUTHORS.md").arg(root);
+        if (indexes.contains(authorsName)) { plugin.authors = readArchiveEntry(p_zip, indexes.value(authorsName)); }
+
+        plugin.path = QString("%1/%2").arg(getRepoPath(repo.id), root.left(root.size() - 1));
+        plugin.folder = folder;
+        plugin.archive = root;
+        plugin.repo = repo;
+
+        // icons are small, keep them next to the archive for the image cache
+        QString iconName = QString("%1%2").arg(root, plugin.icon);
+        if (!plugin.icon.isEmpty() && indexes.contains(iconName)) {
+            QString iconPath = QString("%1/%2").arg(getRepoIconsPath(repo.id), iconName);
+            if (!QFile::exists(iconPath)) {
+                QDir dir;
+                dir.mkpath(QFileInfo(iconPath).absolutePath());
+                QFile icon(iconPath);
+                if (icon.open(QIODevice::WriteOnly)) {
+                    icon.write(readArchiveEntry(p_zip, indexes.value(iconName)));
+                    icon.close();
+                }
+            }
+            plugin.iconUrl = QUrl::fromLocalFile(iconPath);
         }
+        addAvailablePlugin(plugin);
     }
+    _progress->finish(task);
+    zip_close(p_zip);
+
     if ((_availablePlugins.size() > 0 || _availablePluginUpdates.size() > 0) && emitChanges) { emit updatedPlugins(); }
 
     if (emitCache) { emit updatedCache(); }
 }
 
+void Plugins::addAvailablePlugin(const Plugins::PluginSpecs &plugin)
+{
+    _repoPlugins.push_back(plugin);
+    sortAvailablePlugin(plugin);
+}
+
+void Plugins::sortAvailablePlugin(const Plugins::PluginSpecs &plugin)
+{
+    if (!hasAvailablePlugin(plugin.id) &&
+        !hasInstalledPlugin(plugin.id))
+    {
+        _availablePlugins.push_back(plugin);
+    }
+    // linked installs track the repository, they are never updated
+    if (hasInstalledPlugin(plugin.id) &&
+        !getInstalledPlugin(plugin.id).linked &&
+        plugin.version > getInstalledPlugin(plugin.id).version)
+    {
+        _availablePluginUpdates.push_back(plugin);
+    }
+}
+
+void Plugins::addRemotePlugins(const Plugins::RepoSpecs &repo)
+{
+    QString repoPath = getRepoPath(repo.id);
+    for (int i = 0; i < repo.plugins.size(); ++i) {
+        const RepoPluginSpecs &entry = repo.plugins.at(i);
+        QString path = QString("%1/%2").arg(repoPath, entry.folder);
+        // use the cached copy if up to date, else what the manifest tells us
+        PluginSpecs plugin = entry.isAddon ? getAddonSpecs(path) : getPluginSpecs(path);
+        if (plugin.id != entry.id || plugin.version < entry.version) {
+            plugin = PluginSpecs();
+            plugin.id = entry.id;
+            plugin.label = entry.label;
+            plugin.version = entry.version;
+            plugin.group = entry.group;
+            plugin.desc = entry.desc.toHtmlEscaped();
+            plugin.path = path;
+            plugin.folder = entry.folder;
+            plugin.isAddon = entry.isAddon;
+        }
+        plugin.repo = repo;
+        plugin.zip = entry.zip;
+        plugin.checksum = entry.checksum;
+        plugin.iconUrl = entry.icon;
+        addAvailablePlugin(plugin);
+    }
+}
+
 void Plugins::scanForInstalledPlugins(const QStringList &paths)
 {
     for (int i = 0; i < paths.size(); ++i) { scanForInstalledPlugins(paths.at(i), true); }
 }
 
+void Plugins::scanForInstalledPlugins()
+{
+    _installedPlugins.clear();
+
+    scanForInstalledPlugins(getSystemPluginPaths());
+    scanForInstalledPlugins(getUserPluginPath(), true);
+    scanForInstalledPlugins(getNatronCustomPaths());
+    scanForInstalledPlugins(getUserAddonPath(), true);
+}
+
+Plugins::PluginType Plugins::patchPlugin(const QString &id)
+{
+    // only this plug-in moves between the lists, its folders are the only ones parsed
+    QStringList folders;
+    if (hasInstalledPlugin(id)) { folders << getInstalledPlugin(id).path; }
+    for (unsigned long i = 0; i < _repoPlugins.size(); ++i) {
+        const PluginSpecs &plugin = _repoPlugins.at(i);
+        if (plugin.id != id) { continue; }
+        QString folder = QString("%1/%2").arg(plugin.isAddon ? getUserAddonPath() : getUserPluginPath(),
+                                              plugin.folder);
+        if (!folders.contains(folder)) { folders << folder; }
+    }
+
+    removePluginEntries(_installedPlugins, id);
+    removePluginEntries(_availablePlugins, id);
+    removePluginEntries(_availablePluginUpdates, id);
+
+    for (int i = 0; i < folders.size(); ++i) {
+        PluginSpecs plugin = getFolderSpecs(folders.at(i));
+        if (plugin.id == id) {
+            _installedPlugins.push_back(plugin);
+            break;
+        }
+    }
+    for (unsigned long i = 0; i < _repoPlugins.size(); ++i) {
+        if (_repoPlugins.at(i).id == id) { sortAvailablePlugin(_repoPlugins.at(i)); }
+    }
+
+    PluginType type = NATRON_PLUGIN_TYPE_NONE;
+    if (hasUpdatedPlugin(id)) { type = NATRON_PLUGIN_TYPE_UPDATE; }
+    else if (hasAvailablePlugin(id)) { type = NATRON_PLUGIN_TYPE_AVAILABLE; }
+    else if (hasInstalledPlugin(id)) { type = NATRON_PLUGIN_TYPE_INSTALLED; }
+    emit updatedPlugin(id, type);
+    return type;
+}
+
+void Plugins::removePluginEntries(std::vector<Plugins::PluginSpecs> &plugins,
+                                  const QString &id)
+{
+    for (unsigned long i = plugins.size(); i > 0; --i) {
+        if (plugins.at(i - 1).id == id) { plugins.erase(plugins.begin() + (i - 1)); }
+    }
+}
+
 void Plugins::scanForInstalledPlugins(const QString &path,
                                       bool append)
 {
     qDebug() << "scan for plugins" << path;
     if (!QFile::exists(path)) { return; }
     if (!append) { _installedPlugins.clear(); }
-    QDirIterator it(path,
-                    QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks,
-                    QDirIterator::Subdirectories);
-    while (it.hasNext()) {
-        QString item = it.next();
-        if (!folderHasPlugin(item) && !folderHasAddon(item)) { continue; }
-        PluginSpecs plugin = folderHasPlugin(item) ? getPluginSpecs(item) : folderHasAddon(item) ? getAddonSpecs(item) : PluginSpecs();
+    std::vector<PluginSpecs> plugins = findPlugins(path);
+    for (unsigned long i = 0; i < plugins.size(); ++i) {
+        if (!hasInstalledPlugin(plugins.at(i).id)) {
+            _installedPlugins.push_back(plugins.at(i));
+        }
+    }
+
+    // linked installs, never walk into where they point
+    QFileInfoList links = QDir(path).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (int i = 0; i < links.size(); ++i) {
+        if (!links.at(i).isSymLink()) { continue; }
+        PluginSpecs plugin = getFolderSpecs(links.at(i).filePath());
+        if (plugin.id.isEmpty()) { continue; }
         if (!hasInstalledPlugin(plugin.id)) {
             _installedPlugins.push_back(plugin);
         }
@@ -290,14 +542,13 @@ const std::vector<Plugins::PluginSpecs> Plugins::getPluginsInGroup(Plugins::Plug
     return result;
 }
 
-const QString Plugins::getValueFromFile(const QString &key,
-                                        const QString &filename,
-                                        bool toHtml)
+const QString Plugins::getValueFromDevice(const QString &key,
+                                          QIODevice *device,
+                                          bool toHtml)
 {
     QString value;
-    QFile file(filename);
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QTextStream in(&file);
+    if (device && device->isOpen()) {
+        QTextStream in(device);
         bool getValue = false;
         while(!in.atEnd()) {
             QString line = in.readLine();
@@ -317,6 +568,32 @@ const QString Plugins::getValueFromFile(const QString &key,
                 break;
             }
         }
+    }
+    return value;
+}
+
+const QString Plugins::getValueFromData(const QString &key,
+                                        const QByteArray &data,
+                                        bool toHtml)
+{
+    QString value;
+    QBuffer buffer;
+    buffer.setData(data);
+    if (buffer.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        value = getValueFromDevice(key, &buffer, toHtml);
+        buffer.close();
+    }
+    return value;
+}
+
+const QString Plugins::getValueFromFile(const QString &key,
+                                        const QString &filename,
+                                        bool toHtml)
+{
+    QString value;
+    QFile file(filename);
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        value = getValueFromDevice(key, &file, toHtml);
         file.close();
     }
     return value;
@@ -337,12 +614,11 @@ Plugins::PluginSpecs Plugins::getPluginSpecs(const QString &path)
     QString authors = QString("%1/AUTHORS.md").arg(path);
 
     if (QFile::exists(pyFile)) {
-        specs.id = getValueFromFile("getPluginID():", pyFile);
-        specs.label = QString(getValueFromFile("getLabel():", pyFile)).replace("_", " ");
-        specs.version = getValueFromFile("getVersion():", pyFile).toDouble();
-        specs.icon = getValueFromFile("getIconPath():", pyFile);
-        specs.group = QString(getValueFromFile("getGrouping():", pyFile)).replace("Community/", "");
-        specs.desc = getValueFromFile("getPluginDescription():", pyFile, true);
+        QFile py(pyFile);
+        if (py.open(QIODevice::ReadOnly)) {
+            parsePluginPy(specs, py.readAll());
+            py.close();
+        }
         specs.path = path;
         specs.folder = folder;
         QFileInfo info(pyFile);
@@ -404,6 +680,49 @@ Plugins::PluginSpecs Plugins::getAddonSpecs(const QString &path)
     specs.writable = info.isWritable();
 
     QFile readmeFile(readme);
+    if (readmeFile.open(QIODevice::ReadOnly)) {
+        parseAddonReadme(specs, readmeFile.readAll());
+        readmeFile.close();
+    }
+
+    if (QFile::exists(changes)) {
+        QFile changesFile(changes);
+        if (changesFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            specs.changes = changesFile.readAll();
+            changesFile.close();
+        }
+    }
+
+    if (QFile::exists(authors)) {
+        QFile authorsFile(authors);
+        if (authorsFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            specs.authors = authorsFile.readAll();
+            authorsFile.close();
+        }
+    }
+
+    //qDebug() << "ADDON" << specs.id << specs.label << specs.version << specs.group << specs.key << specs.modifier;
+    //qDebug() << "ADDON README" << specs.readme;
+
+    return specs;
+}
+
+void Plugins::parsePluginPy(Plugins::PluginSpecs &specs,
+                            const QByteArray &py)
+{
+    specs.id = getValueFromData("getPluginID():", py);
+    specs.label = QString(getValueFromData("getLabel():", py)).replace("_", " ");
+    specs.version = getValueFromData("getVersion():", py).toDouble();
+    specs.icon = getValueFromData("getIconPath():", py);
+    specs.group = QString(getValueFromData("getGrouping():", py)).replace("Community/", "");
+    specs.desc = getValueFromData("getPluginDescription():", py, true);
+}
+
+void Plugins::parseAddonReadme(Plugins::PluginSpecs &specs,
+                               const QByteArray &readme)
+{
+    QBuffer readmeFile;
+    readmeFile.setData(readme);
     if (readmeFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
         QTextStream in(&readmeFile);
         while (!in.atEnd()) {
@@ -427,33 +746,10 @@ Plugins::PluginSpecs Plugins::getAddonSpecs(const QString &path)
                if (!mod.isEmpty()) { specs.modifier = mod; }
            }
         }
-        readmeFile.close();
-    }
-    if (readmeFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        readmeFile.seek(0);
         specs.readme = readmeFile.readAll();
         readmeFile.close();
     }
-
-    if (QFile::exists(changes)) {
-        QFile changesFile(changes);
-        if (changesFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            specs.changes = changesFile.readAll();
-            changesFile.close();
-        }
-    }
-
-    if (QFile::exists(authors)) {
-        QFile authorsFile(authors);
-        if (authorsFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            specs.authors = authorsFile.readAll();
-            authorsFile.close();
-        }
-    }
-
-    //qDebug() << "ADDON" << specs.id << specs.label << specs.version << specs.group << specs.key << specs.modifier;
-    //qDebug() << "ADDON README" << specs.readme;
-
-    return specs;
 }
 
 bool Plugins::isValidPlugin(const Plugins::PluginSpecs &plugin)
@@ -473,6 +769,15 @@ bool Plugins::isValidAddon(const Plugins::PluginSpecs &addon)
     return isValidPlugin(addon);
 }
 
+Plugins::PluginSpecs Plugins::getFolderSpecs(const QString &path)
+{
+    // an add-on also has <folder>.py, so only parse it as one if it's not a plug-in
+    PluginSpecs specs = getPluginSpecs(path);
+    if (specs.id.isEmpty()) { specs = getAddonSpecs(path); }
+    specs.linked = QFileInfo(path).isSymLink();
+    return specs;
+}
+
 bool Plugins::folderHasPlugin(const QString &path)
 {
     if (!QFile::exists(path)) { return false; }
@@ -489,38 +794,6 @@ bool Plugins::folderHasAddon(const QString &path)
     return false;
 }
 
-int Plugins::folderHasPlugins(const QString &path)
-{
-    int plugins = 0;
-    if (!QFile::exists(path)) { return plugins; }
-    QDirIterator it(path,
-                    QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks,
-                    QDirIterator::Subdirectories);
-    while (it.hasNext()) {
-        QString item = it.next();
-        if (!folderHasPlugin(item)) { continue; }
-        PluginSpecs plugin = getPluginSpecs(item);
-        if (isValidPlugin(plugin)) { plugins++; }
-    }
-    return plugins;
-}
-
-int Plugins::folderHasAddons(const QString &path)
-{
-    int addons = 0;
-    if (!QFile::exists(path)) { return addons; }
-    QDirIterator it(path,
-                    QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks,
-                    QDirIterator::Subdirectories);
-    while (it.hasNext()) {
-        QString item = it.next();
-        if (!folderHasAddon(item)) { continue; }
-        PluginSpecs addon = getAddonSpecs(item);
-        if (isValidAddon(addon)) { addons++; }
-    }
-    return addons;
-}
-
 const QString Plugins::getUserNatronPath()
 {
     QString folder = QString("%1/.Natron").arg(QDir::homePath());
@@ -581,6 +854,101 @@ void Plugins::setUserAddonPath(const QString &path)
     settings.sync();
 }
 
+int Plugins::getExtractThreads()
+{
+    QSettings settings;
+    int threads = settings.value(PLUGINS_SETTINGS_EXTRACT_THREADS, 0).toInt();
+    if (threads < 1) { threads = QThread::idealThreadCount(); }
+    return threads > 0 ? threads : 1;
+}
+
+void Plugins::setExtractThreads(int threads)
+{
+    QSettings settings;
+    settings.setValue(PLUGINS_SETTINGS_EXTRACT_THREADS, threads);
+    settings.sync();
+}
+
+bool Plugins::getExtractSelective()
+{
+    QSettings settings;
+    return settings.value(PLUGINS_SETTINGS_EXTRACT_SELECTIVE, false).toBool();
+}
+
+void Plugins::setExtractSelective(bool selective)
+{
+    QSettings settings;
+    settings.setValue(PLUGINS_SETTINGS_EXTRACT_SELECTIVE, selective);
+    settings.sync();
+}
+
+const QStringList Plugins::getExtractGroups()
+{
+    QSettings settings;
+    return settings.value(PLUGINS_SETTINGS_EXTRACT_GROUPS).toStringList();
+}
+
+void Plugins::setExtractGroups(const QStringList &groups)
+{
+    QSettings settings;
+    settings.setValue(PLUGINS_SETTINGS_EXTRACT_GROUPS, groups);
+    settings.sync();
+}
+
+bool Plugins::getExtractIncremental()
+{
+    QSettings settings;
+    return settings.value(PLUGINS_SETTINGS_EXTRACT_INCREMENTAL, true).toBool();
+}
+
+void Plugins::setExtractIncremental(bool incremental)
+{
+    QSettings settings;
+    settings.setValue(PLUGINS_SETTINGS_EXTRACT_INCREMENTAL, incremental);
+    settings.sync();
+}
+
+bool Plugins::getArchiveStorage()
+{
+    QSettings settings;
+    return settings.value(PLUGINS_SETTINGS_ARCHIVE_STORAGE, false).toBool();
+}
+
+void Plugins::setArchiveStorage(bool archive)
+{
+    QSettings settings;
+    settings.setValue(PLUGINS_SETTINGS_ARCHIVE_STORAGE, archive);
+    settings.sync();
+}
+
+bool Plugins::getObjectStore()
+{
+    QSettings settings;
+    return ObjectStore::isSupported() && settings.value(PLUGINS_SETTINGS_OBJECT_STORE, false).toBool();
+}
+
+void Plugins::setObjectStore(bool store)
+{
+    QSettings settings;
+    settings.setValue(PLUGINS_SETTINGS_OBJECT_STORE, store);
+    settings.sync();
+}
+
+int Plugins::getInstallMode()
+{
+    QSettings settings;
+    int mode = settings.value(PLUGINS_SETTINGS_INSTALL_MODE, PLUGINS_INSTALL_MODE_COPY).toInt();
+    if (mode != PLUGINS_INSTALL_MODE_SYMLINK) { mode = PLUGINS_INSTALL_MODE_COPY; } // hardlinks (1) are read as copies
+    return mode;
+}
+
+void Plugins::setInstallMode(int mode)
+{
+    QSettings settings;
+    settings.setValue(PLUGINS_SETTINGS_INSTALL_MODE, mode);
+    settings.sync();
+}
+
 const QStringList Plugins::getSystemPluginPaths()
 {
     QStringList paths;
@@ -626,12 +994,14 @@ qint64 Plugins::getCacheSize()
 {
     qint64 total = 0;
     QString folder = getCachePath();
+    QString objects = getObjectStorePath();
     if (QFile::exists(folder)) {
         QDirIterator it(folder,
                         QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks,
                         QDirIterator::Subdirectories);
         while (it.hasNext()) {
-            total += it.fileInfo().size();
+            // objects are linked from the repositories, don't count them twice
+            if (!it.filePath().startsWith(objects)) { total += it.fileInfo().size(); }
             it.next();
         }
     }
@@ -686,13 +1056,318 @@ const QString Plugins::getTempPath()
     return cache;
 }
 
-const QString Plugins::genNewRepoID()
+const QString Plugins::getImageCachePath()
 {
-    QString repoPath = getRepoPath();
-    QString uid = getRandom();
-    int trys = 0;
-    while (QFile::exists(QString("%1/%2.xml").arg(repoPath, uid)) ||
-           QFile::exists(QString("%1/%2").arg(repoPath, uid)))
+    QString folder = getCachePath();
+    if (folder.isEmpty()) { return folder; }
+    return QString("%1/Images").arg(folder);
+}
+
+ImageCache* Plugins::getImageCache()
+{
+    return _images;
+}
+
+const QString Plugins::getObjectStorePath()
+{
+    QString folder = getCachePath();
+    if (folder.isEmpty()) { return folder; }
+    return QString("%1/Objects").arg(folder);
+}
+
+ObjectStore* Plugins::getObjects()
+{
+    return _objects;
+}
+
+const QString Plugins::getTrashPath()
+{
+    QString folder = getCachePath();
+    if (folder.isEmpty()) { return folder; }
+    return QString("%1/Trash").arg(folder);
+}
+
+Trash* Plugins::getTrash()
+{
+    return _trash;
+}
+
+const QString Plugins::getRepoIndexPath(const QString &uid)
+{
+    if (uid.isEmpty()) { return QString(); }
+    return getRepoPath(QString("%1.files").arg(uid));
+}
+
+QHash<QString, Plugins::FileSpecs> Plugins::readFileIndex(const QByteArray &data)
+{
+    QHash<QString, FileSpecs> files;
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+    if (error.error != QJsonParseError::NoError) {
+        qWarning() << "Invalid file index" << error.errorString();
+        return files;
+    }
+    QJsonArray entries = doc.object().value("files").toArray();
+    for (int i = 0; i < entries.size(); ++i) {
+        QJsonObject entry = entries.at(i).toObject();
+        FileSpecs file;
+        file.path = QDir::cleanPath(entry.value("path").toString());
+        file.size = qint64(entry.value("size").toDouble());
+        file.checksum = entry.value("sha256").toString().toLower();
+        file.modified = qint64(entry.value("modified").toDouble());
+        file.crc = quint32(entry.value("crc").toDouble());
+        if (file.path.isEmpty() ||
+            QDir::isAbsolutePath(file.path) ||
+            file.path == ".." ||
+            file.path.startsWith("../")) { continue; } // outside the repository
+        files.insert(file.path, file);
+    }
+    return files;
+}
+
+bool Plugins::writeFileIndex(const QString &filename,
+                             const QHash<QString, Plugins::FileSpecs> &files)
+{
+    QJsonArray entries;
+    QHashIterator<QString, FileSpecs> i(files);
+    while (i.hasNext()) {
+        i.next();
+        QJsonObject entry;
+        entry.insert("path", i.value().path);
+        entry.insert("size", double(i.value().size));
+        entry.insert("sha256", i.value().checksum);
+        entry.insert("modified", double(i.value().modified));
+        if (i.value().crc > 0) { entry.insert("crc", double(i.value().crc)); }
+        entries.append(entry);
+    }
+    QJsonObject index;
+    index.insert("files", entries);
+    QFile file(filename);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qint64 res = file.write(QJsonDocument(index).toJson(QJsonDocument::Compact));
+        file.close();
+        if (res > -1) { return true; }
+    }
+    return false;
+}
+
+QHash<QString, Plugins::FileSpecs> Plugins::getLocalFileIndex(const QString &uid,
+                                                              const QHash<QString, Plugins::FileSpecs> &cached)
+{
+    // no members, this runs in the background
+    QHash<QString, FileSpecs> files;
+    QString repoPath = getRepoPath(uid);
+    if (repoPath.isEmpty() || !QFile::exists(repoPath)) { return files; }
+
+    // only hash files that changed since last time
+    QHash<QString, FileSpecs> known = cached;
+    if (known.isEmpty()) {
+        QFile cache(getRepoIndexPath(uid));
+        if (cache.open(QIODevice::ReadOnly)) {
+            known = readFileIndex(cache.readAll());
+            cache.close();
+        }
+    }
+
+    QDir root(repoPath);
+    QDirIterator it(repoPath,
+                    QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot | QDir::NoSymLinks,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        QFileInfo info = it.fileInfo();
+        FileSpecs file;
+        file.path = root.relativeFilePath(info.filePath());
+        file.size = info.size();
+        file.modified = info.lastModified().toMSecsSinceEpoch();
+        FileSpecs last = known.value(file.path);
+        if (last.size == file.size &&
+            last.modified == file.modified &&
+            !last.checksum.isEmpty()) { file.checksum = last.checksum; }
+        else {
+            QFile input(info.filePath());
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            if (input.open(QIODevice::ReadOnly) && hash.addData(&input)) {
+                file.checksum = QString::fromLatin1(hash.result().toHex());
+            }
+        }
+        files.insert(file.path, file);
+    }
+
+    writeFileIndex(getRepoIndexPath(uid), files);
+    return files;
+}
+
+const QString Plugins::getRepoArchivePath(const QString &uid)
+{
+    if (uid.isEmpty()) { return QString(); }
+    return getRepoPath(QString("%1.zip").arg(uid));
+}
+
+const QString Plugins::getRepoIconsPath(const QString &uid)
+{
+    if (uid.isEmpty()) { return QString(); }
+    return getRepoPath(QString("%1.icons").arg(uid));
+}
+
+const QString Plugins::getRepoExtractTablePath(const QString &uid)
+{
+    if (uid.isEmpty()) { return QString(); }
+    return getRepoPath(QString("%1.crc").arg(uid));
+}
+
+const QString Plugins::getRepoCatalogPath(const QString &uid)
+{
+    if (uid.isEmpty()) { return QString(); }
+    return getRepoPath(QString("%1.cbor").arg(uid));
+}
+
+QList<Plugins::RepoPluginSpecs> Plugins::readCatalog(const QByteArray &data)
+{
+    QList<RepoPluginSpecs> plugins;
+    double version = 0;
+    QCborStreamReader reader(data);
+    if (!reader.isMap()) { return plugins; }
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        QString key = readCatalogString(reader);
+        if (key == QString(CATALOG_KEY_VERSION)) {
+            version = readCatalogNumber(reader);
+            if (version != CATALOG_VERSION) { break; } // no need to read the rest
+        } else if (key == QString(CATALOG_KEY_PLUGINS) && reader.isArray()) {
+            reader.enterContainer();
+            while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+                RepoPluginSpecs plugin = readCatalogPlugin(reader);
+                if (isValidRepoPlugin(plugin)) { plugins.append(plugin); }
+                else { qWarning() << "Invalid plug-in in catalog" << plugin.id; }
+            }
+            if (reader.lastError() == QCborError::NoError) { reader.leaveContainer(); }
+        } else { reader.next(); }
+    }
+    if (reader.lastError() != QCborError::NoError) {
+        qWarning() << "Invalid catalog" << reader.lastError().toString();
+        plugins.clear();
+    } else if (version != CATALOG_VERSION) { // missing, unknown or newer than we understand
+        qWarning() << "Unsupported catalog version" << version;
+        plugins.clear();
+    }
+    return plugins;
+}
+
+QByteArray Plugins::writeCatalog(const QList<Plugins::RepoPluginSpecs> &plugins)
+{
+    QByteArray data;
+    QCborStreamWriter writer(&data);
+    writer.startMap(2);
+    writer.append(QLatin1String(CATALOG_KEY_VERSION));
+    writer.append(qint64(CATALOG_VERSION));
+    writer.append(QLatin1String(CATALOG_KEY_PLUGINS));
+    writer.startArray(quint64(plugins.size()));
+    for (int i = 0; i < plugins.size(); ++i) {
+        const RepoPluginSpecs &plugin = plugins.at(i);
+        writer.startMap(11);
+        writer.append(QLatin1String(MANIFEST_TAG_ID));
+        writer.append(plugin.id);
+        writer.append(QLatin1String(MANIFEST_TAG_LABEL));
+        writer.append(plugin.label);
+        writer.append(QLatin1String(MANIFEST_TAG_VERSION));
+        writer.append(plugin.version);
+        writer.append(QLatin1String(MANIFEST_TAG_GROUP));
+        writer.append(plugin.group);
+        writer.append(QLatin1String(MANIFEST_TAG_FOLDER));
+        writer.append(plugin.folder);
+        writer.append(QLatin1String(MANIFEST_TAG_DESCRIPTION));
+        writer.append(plugin.desc);
+        writer.append(QLatin1String(MANIFEST_TAG_ADDON));
+        writer.append(plugin.isAddon);
+        writer.append(QLatin1String(MANIFEST_TAG_ICON));
+        writer.append(plugin.icon.toString());
+        writer.append(QLatin1String(MANIFEST_TAG_ZIP));
+        writer.append(plugin.zip.toString());
+        writer.append(QLatin1String(MANIFEST_TAG_SIZE));
+        writer.append(plugin.size);
+        writer.append(QLatin1String(MANIFEST_TAG_CHECKSUM));
+        writer.append(plugin.checksum);
+        writer.endMap();
+    }
+    writer.endArray();
+    writer.endMap();
+    return data;
+}
+
+Plugins::RepoPluginSpecs Plugins::readCatalogPlugin(QCborStreamReader &reader)
+{
+    RepoPluginSpecs plugin;
+    if (!reader.isMap()) {
+        reader.next();
+        return plugin;
+    }
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        QString key = readCatalogString(reader);
+        if (key == QString(MANIFEST_TAG_ID)) {
+            plugin.id = readCatalogString(reader).trimmed();
+        } else if (key == QString(MANIFEST_TAG_LABEL)) {
+            plugin.label = readCatalogString(reader).trimmed();
+        } else if (key == QString(MANIFEST_TAG_VERSION)) {
+            plugin.version = readCatalogNumber(reader);
+        } else if (key == QString(MANIFEST_TAG_GROUP)) {
+            plugin.group = readCatalogString(reader).trimmed();
+        } else if (key == QString(MANIFEST_TAG_FOLDER)) {
+            plugin.folder = readCatalogString(reader).trimmed();
+        } else if (key == QString(MANIFEST_TAG_DESCRIPTION)) {
+            plugin.desc = readCatalogString(reader).trimmed();
+        } else if (key == QString(MANIFEST_TAG_ADDON)) {
+            if (reader.isBool()) { plugin.isAddon = reader.toBool(); }
+            reader.next();
+        } else if (key == QString(MANIFEST_TAG_ICON)) {
+            QString icon = readCatalogString(reader).trimmed();
+            if (!icon.isEmpty()) { plugin.icon = QUrl::fromUserInput(icon); }
+        } else if (key == QString(MANIFEST_TAG_ZIP)) {
+            plugin.zip = QUrl::fromUserInput(readCatalogString(reader).trimmed());
+        } else if (key == QString(MANIFEST_TAG_SIZE)) {
+            plugin.size = qint64(readCatalogNumber(reader));
+        } else if (key == QString(MANIFEST_TAG_CHECKSUM)) {
+            plugin.checksum = readCatalogString(reader).trimmed();
+        } else { reader.next(); }
+    }
+    if (reader.lastError() == QCborError::NoError) { reader.leaveContainer(); }
+    return plugin;
+}
+
+const QString Plugins::readCatalogString(QCborStreamReader &reader)
+{
+    QString result;
+    if (!reader.isString()) {
+        reader.next();
+        return result;
+    }
+    auto chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        result.append(chunk.data);
+        chunk = reader.readString();
+    }
+    if (chunk.status == QCborStreamReader::Error) { result.clear(); }
+    return result;
+}
+
+double Plugins::readCatalogNumber(QCborStreamReader &reader)
+{
+    double result = 0.0;
+    if (reader.isDouble()) { result = reader.toDouble(); }
+    else if (reader.isFloat()) { result = reader.toFloat(); }
+    else if (reader.isInteger()) { result = double(reader.toInteger()); }
+    reader.next();
+    return result;
+}
+
+const QString Plugins::genNewRepoID()
+{
+    QString repoPath = getRepoPath();
+    QString uid = getRandom();
+    int trys = 0;
+    while (QFile::exists(QString("%1/%2.xml").arg(repoPath, uid)) ||
+           QFile::exists(QString("%1/%2").arg(repoPath, uid)))
     {
         uid = getRandom();
         if (trys > 10) { return QString(); }
@@ -701,8 +1376,41 @@ const QString Plugins::genNewRepoID()
     return uid;
 }
 
+bool Plugins::isPluginDownloaded(const Plugins::PluginSpecs &plugin)
+{
+    if (plugin.zip.isEmpty()) { return true; } // part of the repository zip
+    PluginSpecs cached = plugin.isAddon ? getAddonSpecs(plugin.path) : getPluginSpecs(plugin.path);
+    return cached.id == plugin.id && cached.version >= plugin.version;
+}
+
+Plugins::PluginStatus Plugins::downloadPlugin(const Plugins::PluginSpecs &plugin,
+                                              bool update)
+{
+    PluginStatus status;
+    if (plugin.zip.isEmpty() || !plugin.zip.isValid()) {
+        status.message = tr("Plug-in %1 has no archive to download").arg(plugin.label);
+        return status;
+    }
+    status.pending = true;
+    status.message = tr("Downloading %1 ...").arg(plugin.label);
+    if (_pendingPlugins.contains(plugin.id)) { return status; }
+    _pendingPlugins.insert(plugin.id, update);
+    addDownloadUrl(plugin.zip);
+    return status;
+}
+
 Plugins::PluginStatus Plugins::installPlugin(const QString &id,
                                              bool update)
+{
+    PluginSpecs plugin;
+    PluginStatus status = prepareInstall(id, update, &plugin);
+    if (!status.success) { return status; }
+    return installPluginFolder(plugin, !update);
+}
+
+Plugins::PluginStatus Plugins::prepareInstall(const QString &id,
+                                              bool update,
+                                              Plugins::PluginSpecs *plugin)
 {
     PluginStatus status;
     if (hasInstalledPlugin(id) && !update) {
@@ -713,20 +1421,53 @@ Plugins::PluginStatus Plugins::installPlugin(const QString &id,
         status.message = tr("Plug-in not available");
         return  status;
     }
-    PluginSpecs plugin = getAvailablePlugin(id);
-    if (update) { plugin = getUpdatedPlugin(id); }
-    if (!isValidPlugin(plugin)) {
+    *plugin = update ? getUpdatedPlugin(id) : getAvailablePlugin(id);
+    if (!isValidPlugin(*plugin)) {
         status.message = tr("Not a valid plug-in");
         return  status;
     }
+    if (!isPluginDownloaded(*plugin)) { return downloadPlugin(*plugin, update); }
+    status.success = true;
+    return status;
+}
 
+Plugins::PluginStatus Plugins::installPluginFolder(const Plugins::PluginSpecs &plugin,
+                                                   bool cancellable)
+{
+    PluginStatus status;
     QString userPath = plugin.isAddon ? getUserAddonPath() : getUserPluginPath();
     QString destPath = QString("%1/%2").arg(userPath, plugin.folder);
+    QFileInfo destInfo(destPath);
+    if (destInfo.isSymLink() && !destInfo.exists()) { QFile::remove(destPath); } // linked to a removed repository
     if (QFile::exists(destPath)) {
         status.message = tr("Plug-in directory (%1) already exists").arg(destPath);
         return status;
     }
 
+    PluginStatus res = installPluginFiles(plugin, destPath, cancellable);
+    if (!res.success) { return res; }
+
+    if (plugin.isAddon) { updateInitGuiPy(); }
+    status.success = true;
+    return status;
+}
+
+Plugins::PluginStatus Plugins::installPluginFiles(const Plugins::PluginSpecs &plugin,
+                                                  const QString &destPath,
+                                                  bool cancellable)
+{
+    PluginStatus status;
+    if (!plugin.archive.isEmpty()) { // archive storage, extract the plug-in folder only
+        PluginStatus res = extractArchiveFolder(getRepoArchivePath(plugin.repo.id), QByteArray(), plugin.archive, destPath);
+        if (!res.success) {
+            QDir failedDir(destPath);
+            failedDir.removeRecursively();
+            return res;
+        }
+        status.success = true; // only the repository cache goes in the object store
+        return status;
+    }
+
     QDir pluginDir(plugin.path);
     QStringList files = pluginDir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks);
     if (files.size() < 1) {
@@ -734,30 +1475,38 @@ Plugins::PluginStatus Plugins::installPlugin(const QString &id,
         return status;
     }
 
-    QDir destDir;
-    if (!destDir.mkpath(destPath)) {
-        status.message = tr("Unable to create directory %1").arg(destPath);
-        return status;
-    }
-    for (int i = 0; i < files.size(); ++i) {
-        QString fileSrc = QString("%1/%2").arg(plugin.path, files.at(i));
-        QString fileDst = QString("%1/%2").arg(destPath, files.at(i));
-        QFile file(fileSrc);
-        QFileInfo info(fileSrc);
-        if (info.isDir()) { continue; }
-        if (!file.copy(fileDst)) {
-            status.message = tr("Unable to copy file %1 to %2").arg(files.at(i), destPath);
-            status.success = false;
+#ifdef Q_OS_UNIX
+    if (getInstallMode() == PLUGINS_INSTALL_MODE_SYMLINK) { // link the folder, copy if we can't
+        QDir userDir;
+        userDir.mkpath(QFileInfo(destPath).absolutePath());
+        if (QFile::link(QFileInfo(plugin.path).absoluteFilePath(), destPath)) {
+            status.success = true;
             return status;
         }
     }
+#endif
+
+    PluginStatus res = installFolder(plugin.path, destPath, cancellable);
+    if (!res.success) {
+        QDir failedDir(destPath);
+        failedDir.removeRecursively();
+        return res;
+    }
 
-    if (plugin.isAddon) { writeInitGuiPy(generateInitGuiPy()); }
     status.success = true;
     return status;
 }
 
 Plugins::PluginStatus Plugins::removePlugin(const QString &id)
+{
+    PluginSpecs plugin;
+    PluginStatus status = prepareRemove(id, &plugin);
+    if (!status.success) { return status; }
+    return removePluginFolder(plugin);
+}
+
+Plugins::PluginStatus Plugins::prepareRemove(const QString &id,
+                                             Plugins::PluginSpecs *plugin)
 {
     PluginStatus status;
     if (!hasInstalledPlugin(id)) {
@@ -766,19 +1515,25 @@ Plugins::PluginStatus Plugins::removePlugin(const QString &id)
         return status;
     }
 
-    PluginSpecs plugin = getInstalledPlugin(id);
-    if (!isValidPlugin(plugin)) {
+    *plugin = getInstalledPlugin(id);
+    if (!isValidPlugin(*plugin)) {
         status.message = tr("Plug-in not found or is invalid");
         status.success = false;
         return  status;
     }
+    status.success = true;
+    return status;
+}
 
+Plugins::PluginStatus Plugins::removePluginFolder(const Plugins::PluginSpecs &plugin)
+{
+    PluginStatus status;
     QString userPath = plugin.isAddon ? getUserAddonPath() : getUserPluginPath();
     QString destPath = QString("%1/%2").arg(userPath, plugin.folder);
-    if (QFile::exists(destPath)) {
-        QDir dir(destPath);
-        if (!dir.removeRecursively()) {
-            status.message = tr("Unable to remove directory %1").arg(destPath);
+    QFileInfo destInfo(destPath);
+    if (destInfo.exists() || destInfo.isSymLink()) { // a rename, deleted later by the trash
+        if (!_trash->move(destPath, plugin.id)) {
+            status.message = tr("Unable to remove %1").arg(destPath);
             status.success = false;
         } else { status.success = true; }
     } else {
@@ -786,28 +1541,296 @@ Plugins::PluginStatus Plugins::removePlugin(const QString &id)
         status.success = false;
     }
 
-    if (status.success && plugin.isAddon) { writeInitGuiPy(generateInitGuiPy()); }
+    if (status.success && plugin.isAddon) { updateInitGuiPy(); }
     return  status;
 }
 
+Plugins::PluginStatus Plugins::restorePlugin(const QString &id)
+{
+    PluginStatus status;
+    if (hasInstalledPlugin(id)) {
+        status.message = tr("Plug-in already installed");
+        return status;
+    }
+    QString path = _trash->restore(id);
+    if (path.isEmpty()) {
+        status.message = tr("Unable to restore plug-in %1").arg(id);
+        return status;
+    }
+    if (folderHasAddon(path)) { updateInitGuiPy(); }
+    patchPlugin(id);
+    status.success = true;
+    return status;
+}
+
+bool Plugins::hasTrashedPlugin(const QString &id)
+{
+    return _trash->has(id);
+}
+
 Plugins::PluginStatus Plugins::updatePlugin(const QString &id)
+{
+    PluginSpecs installed;
+    PluginSpecs plugin;
+    PluginStatus status = prepareUpdate(id, &installed, &plugin);
+    if (!status.success) { return status; }
+    return updatePluginFolder(installed, plugin);
+}
+
+Plugins::PluginStatus Plugins::prepareUpdate(const QString &id,
+                                             Plugins::PluginSpecs *installed,
+                                             Plugins::PluginSpecs *plugin)
 {
     PluginStatus status;
     status.success = false;
-    if (hasInstalledPlugin(id)) {
-        PluginStatus removedPlugin = removePlugin(id);
-        if (removedPlugin.success) {
-            PluginStatus installedPlugin = installPlugin(id, true);
-            if (installedPlugin.success) { status.success = true; }
-            else { status = installedPlugin; }
-        } else { status = removedPlugin; }
-    } else { status.message = tr("Plug-in is not installed."); }
+    if (!hasInstalledPlugin(id)) {
+        status.message = tr("Plug-in is not installed.");
+        return status;
+    }
+    *installed = getInstalledPlugin(id);
+    *plugin = getUpdatedPlugin(id);
+    if (!isValidPlugin(*installed) || !isValidPlugin(*plugin)) {
+        status.message = tr("Not a valid plug-in");
+        return status;
+    }
+    if (!isPluginDownloaded(*plugin)) {
+        return downloadPlugin(*plugin, true); // keep the installed plug-in until we have the update
+    }
+    status.success = true;
+    return status;
+}
+
+Plugins::PluginStatus Plugins::updatePluginFolder(const Plugins::PluginSpecs &installed,
+                                                  const Plugins::PluginSpecs &plugin)
+{
+    PluginStatus status;
+    status.success = false;
+
+    // stage next to the installed plug-in so the swap is a rename on the same filesystem
+    QString userPath = plugin.isAddon ? getUserAddonPath() : getUserPluginPath();
+    QString installedPath = QString("%1/%2").arg(userPath, installed.folder);
+    QString destPath = QString("%1/%2").arg(userPath, plugin.folder);
+    QString uid = getRandom(userPath, ".update");
+    if (uid.isEmpty()) {
+        status.message = tr("Unable to create staging directory in %1").arg(userPath);
+        return status;
+    }
+    QString staging = QString("%1/.%2.update").arg(userPath, uid);
+    QString old = QString("%1/.%2.old").arg(userPath, uid);
+
+    PluginStatus res = installPluginFiles(plugin, staging);
+    if (!res.success) {
+        _trash->discard(staging);
+        return res;
+    }
+
+    // verify the staged plug-in before touching the installed one
+    PluginSpecs staged = plugin.isAddon ? getAddonSpecs(staging) : getPluginSpecs(staging);
+    if (staged.id != plugin.id || staged.version != plugin.version || !isValidPlugin(staged)) {
+        _trash->discard(staging);
+        status.message = tr("Update of %1 failed verification, keeping version %2").arg(plugin.label)
+                                                                                  .arg(installed.version);
+        return status;
+    }
+
+    // swap, the previous version is kept as old until the new one is in place
+    // and may be the only copy if we are interrupted, remember where it belongs
+    QString oldInfo = QString("%1%2").arg(old, PLUGINS_UPDATE_INFO_SUFFIX);
+    {
+        QSettings settings(oldInfo, QSettings::IniFormat);
+        settings.setValue(PLUGINS_UPDATE_KEY_PATH, installedPath);
+        settings.sync();
+    }
+    bool swapped = false;
+    if (installedPath == destPath) { swapped = swapFolder(staging, destPath, old); }
+    else if (!QFile::exists(destPath) && QFile::rename(installedPath, old)) { // folder was renamed
+        swapped = QFile::rename(staging, destPath);
+        if (!swapped) { QFile::rename(old, installedPath); }
+    }
+    if (!swapped) {
+        _trash->discard(staging);
+        QFile::remove(oldInfo);
+        status.message = tr("Unable to replace %1, keeping version %2").arg(installedPath)
+                                                                       .arg(installed.version);
+        return status;
+    }
+
+    PluginSpecs updated = plugin.isAddon ? getAddonSpecs(destPath) : getPluginSpecs(destPath);
+    if (updated.id != plugin.id || updated.version != plugin.version) { // roll back
+        if (installedPath == destPath) { swapped = swapFolder(old, destPath, staging); }
+        else {
+            swapped = QFile::rename(destPath, staging) && QFile::rename(old, installedPath);
+        }
+        if (!swapped) {
+            status.message = tr("Update of %1 failed and version %2 could not be restored from %3").arg(plugin.label)
+                                                                                                   .arg(installed.version)
+                                                                                                   .arg(old);
+            return status;
+        }
+        _trash->discard(staging);
+        QFile::remove(oldInfo);
+        status.message = tr("Update of %1 failed, restored version %2").arg(plugin.label)
+                                                                       .arg(installed.version);
+        return status;
+    }
+
+    _trash->discard(old);
+    QFile::remove(oldInfo);
+    if (plugin.isAddon) { updateInitGuiPy(); }
+    status.success = true;
+    return status;
+}
+
+std::vector<Plugins::BatchSpecs> Plugins::runBatch(const std::vector<Plugins::BatchSpecs> &batch)
+{
+    std::vector<BatchSpecs> result = batch;
+
+    // initGui.py and the plug-in lists are only updated once when done
+    _isBatch.storeRelease(1);
+    _initGuiPending.storeRelease(0);
+    for (unsigned long i = 0; i < result.size(); ++i) {
+        if (isBatchCancelled()) { // skip the rest, reported without a message
+            emit batchItemFinished(result.at(i).id, result.at(i).type, false, false, QString());
+            continue;
+        }
+        // the lists belong to our thread, only the files are handled here
+        BatchSpecs &item = result[i];
+        QString label;
+        runInOwnerThread([this, &item, &label]() {
+            label = getPlugin(item.id).label;
+            item.status = prepareBatchItem(item);
+        });
+        emit batchItemStarted(item.id, item.type);
+        emit statusMessage(tr("Working on %1 (%2 of %3) ...").arg(label)
+                                                            .arg(i + 1)
+                                                            .arg(result.size()));
+        if (item.status.success) { item.status = runBatchItem(item); }
+        if (item.status.success) { runInOwnerThread([this, &item]() { patchPlugin(item.id); }); }
+        else if (isBatchCancelled()) { item.status.message.clear(); }
+        emit batchItemFinished(item.id,
+                               item.type,
+                               item.status.success,
+                               item.status.pending,
+                               item.status.message);
+    }
+    _isBatch.storeRelease(0);
+
+    if (_initGuiPending.testAndSetOrdered(1, 0)) { writeInitGuiPy(generateInitGuiPy()); }
+    return result;
+}
+
+Plugins::PluginStatus Plugins::prepareBatchItem(Plugins::BatchSpecs &item)
+{
+    PluginStatus status;
+    switch (item.type) {
+    case NATRON_PLUGIN_TYPE_AVAILABLE:
+        status = prepareInstall(item.id, false, &item.plugin);
+        break;
+    case NATRON_PLUGIN_TYPE_INSTALLED:
+        status = prepareRemove(item.id, &item.installed);
+        break;
+    case NATRON_PLUGIN_TYPE_UPDATE:
+        status = prepareUpdate(item.id, &item.installed, &item.plugin);
+        break;
+    default:
+        status.message = tr("Nothing to do for plug-in %1").arg(item.id);
+    }
+    return status;
+}
+
+Plugins::PluginStatus Plugins::runBatchItem(const Plugins::BatchSpecs &item)
+{
+    // files only, everything else was copied into the item by prepareBatchItem
+    PluginStatus status;
+    switch (item.type) {
+    case NATRON_PLUGIN_TYPE_AVAILABLE:
+        status = installPluginFolder(item.plugin, true);
+        break;
+    case NATRON_PLUGIN_TYPE_INSTALLED:
+        status = removePluginFolder(item.installed);
+        break;
+    case NATRON_PLUGIN_TYPE_UPDATE:
+        status = updatePluginFolder(item.installed, item.plugin);
+        break;
+    default:
+        status.message = tr("Nothing to do for plug-in %1").arg(item.id);
+    }
     return status;
 }
 
+void Plugins::runInOwnerThread(const std::function<void()> &func)
+{
+    if (QThread::currentThread() == thread()) { func(); }
+    else { QMetaObject::invokeMethod(this, func, Qt::BlockingQueuedConnection); }
+}
+
+bool Plugins::startBatch(const std::vector<Plugins::BatchSpecs> &batch)
+{
+    // not while a refresh or download may change the lists or the repository cache
+    if (batch.size() < 1 || isBusy() || !_batchRunning.testAndSetOrdered(0, 1)) { return false; }
+    _batchCancel.storeRelaxed(0);
+    QFuture<void> f = QtConcurrent::run(&_batchPool, [this, batch]() {
+        runBatch(batch);
+        bool cancelled = isBatchCancelled();
+        _batchCancel.storeRelaxed(0);
+        _batchRunning.storeRelease(0);
+        QMetaObject::invokeMethod(this, [this]() {
+            if (_checkPending) { // deferred while the batch was running
+                _checkPending = false;
+                checkRepositories();
+            }
+        }, Qt::QueuedConnection);
+        emit batchFinished(cancelled);
+    });
+    Q_UNUSED(f)
+    return true;
+}
+
+void Plugins::startPendingPlugin(const QString &id,
+                                 bool update)
+{
+    // downloaded on demand, installed in the batch pool so it never overlaps a batch
+    BatchSpecs item;
+    item.id = id;
+    item.type = update ? NATRON_PLUGIN_TYPE_UPDATE : NATRON_PLUGIN_TYPE_AVAILABLE;
+    item.status = prepareBatchItem(item);
+    if (!item.status.success) {
+        emit pendingPluginFinished(id, update, false, item.status.message);
+        return;
+    }
+    _pendingJobs << id;
+    QFuture<void> f = QtConcurrent::run(&_batchPool, [this, item, update]() {
+        BatchSpecs result = item;
+        result.status = runBatchItem(result);
+        QMetaObject::invokeMethod(this, [this, result, update]() {
+            _pendingJobs.removeAll(result.id);
+            if (result.status.success) { patchPlugin(result.id); }
+            emit pendingPluginFinished(result.id, update, result.status.success, result.status.message);
+        }, Qt::QueuedConnection);
+    });
+    Q_UNUSED(f)
+}
+
+void Plugins::cancelBatch()
+{
+    if (isBatchRunning()) { _batchCancel.storeRelaxed(1); }
+}
+
+bool Plugins::isBatchRunning()
+{
+    return _batchRunning.loadAcquire() == 1;
+}
+
+bool Plugins::isBatchCancelled()
+{
+    return _batchCancel.loadRelaxed() == 1;
+}
+
 Plugins::PluginStatus Plugins::extractPluginArchive(const QString &filename,
                                                     const QString &folder,
-                                                    const QString &checksum)
+                                                    bool selective,
+                                                    const QString &table,
+                                                    const QString &previous)
 {
     PluginStatus status;
     status.success = true;
@@ -825,85 +1848,825 @@ Plugins::PluginStatus Plugins::extractPluginArchive(const QString &filename,
         return status;
     }
 
-    qDebug() << "checksum?" << checksum;
-
-    struct zip* p_zip = NULL;
-    zip_int64_t n_entries;
-    struct zip_file* p_file = NULL;
-    int bytes_read;
-    char buffer[ZIP_BUF_SIZE];
-
-    int error;
-    p_zip = zip_open(filename.toStdString().c_str(), 0, &error);
+    struct zip* p_zip = openArchive(filename, QByteArray());
     if (p_zip == NULL) {
       status.message = tr("Failed to open %1").arg(filename);
       status.success = false;
       return status;
     }
 
-    n_entries = zip_get_num_entries(p_zip, 0);
+    status = extractArchive(p_zip, filename, folder, QByteArray(), selective, table, previous);
+    zip_close(p_zip);
+
+    return status;
+}
+
+Plugins::PluginStatus Plugins::extractPluginArchive(const QByteArray &data,
+                                                    const QString &folder,
+                                                    bool selective,
+                                                    const QString &table,
+                                                    const QString &previous)
+{
+    PluginStatus status;
+    status.success = false;
+
+    if (data.isEmpty()) {
+        status.message = tr("No archive data to extract");
+        return status;
+    }
+
+    QFileInfo dir(folder);
+    if (!dir.isWritable()) {
+        status.message = tr("Directory %1 is not writable").arg(folder);
+        return status;
+    }
+
+    struct zip* p_zip = openArchive(QString(), data);
+    if (p_zip == NULL) {
+        status.message = tr("Failed to open archive from memory");
+        return status;
+    }
+
+    status = extractArchive(p_zip, tr("archive"), folder, data, selective, table, previous);
+    zip_close(p_zip); // also frees p_source
+
+    return status;
+}
+
+struct zip* Plugins::openArchive(const QString &filename,
+                                 const QByteArray &data)
+{
+    struct zip* p_zip = NULL;
+    if (data.isEmpty()) {
+        int error;
+        p_zip = zip_open(filename.toStdString().c_str(), 0, &error);
+        return p_zip;
+    }
+
+    // the source does not own or copy the buffer, data must outlive p_zip
+    zip_error_t error;
+    zip_error_init(&error);
+    zip_source_t* p_source = zip_source_buffer_create(data.constData(), data.size(), 0, &error);
+    if (p_source) {
+        p_zip = zip_open_from_source(p_source, ZIP_RDONLY, &error);
+        if (p_zip == NULL) { zip_source_free(p_source); }
+    }
+    zip_error_fini(&error);
+    return p_zip;
+}
+
+Plugins::PluginStatus Plugins::extractArchiveFolder(const QString &filename,
+                                                    const QByteArray &data,
+                                                    const QString &root,
+                                                    const QString &folder)
+{
+    PluginStatus status;
+    struct zip* p_zip = openArchive(filename, data);
+    if (p_zip == NULL) {
+        status.message = tr("Failed to open %1").arg(filename.isEmpty() ? folder : filename);
+        return status;
+    }
+
+    std::vector<ArchiveEntrySpecs> entries;
+    QStringList dirs;
+    dirs << folder;
+    zip_int64_t n_entries = zip_get_num_entries(p_zip, 0);
     for (zip_int64_t entry_idx=0; entry_idx < n_entries; entry_idx++) {
         struct zip_stat file_stat;
-        if (zip_stat_index(p_zip, entry_idx, 0, &file_stat)) {
-            status.message = tr("Failed to read file from %1").arg(filename);
+        if (zip_stat_index(p_zip, entry_idx, 0, &file_stat)) { continue; }
+        if (!(file_stat.valid & ZIP_STAT_NAME)) { continue; }
+        QString name = QString::fromUtf8(file_stat.name);
+        if (name.endsWith("/")) { continue; }
+        if (!name.startsWith(root)) { continue; }
+        if (QDir::cleanPath(name) != name) { // "..", "." or "//" could leave the folder
+            status.message = tr("Invalid file %1 in %2").arg(name, filename.isEmpty() ? folder : filename);
+            zip_close(p_zip);
+            return status;
+        }
+        ArchiveEntrySpecs entry;
+        entry.index = entry_idx;
+        entry.name = name.mid(root.size());
+        if (file_stat.valid & ZIP_STAT_SIZE) { entry.size = file_stat.size; }
+        entries.push_back(entry);
+        int slash = entry.name.lastIndexOf("/");
+        if (slash > 0) { dirs << QString("%1/%2").arg(folder, entry.name.left(slash)); }
+    }
+    if (entries.empty()) {
+        status.message = tr("No %1 in %2").arg(root, filename.isEmpty() ? folder : filename);
+        zip_close(p_zip);
+        return status;
+    }
+
+    dirs.removeDuplicates();
+    for (int i = 0; i < dirs.size(); ++i) {
+        QDir newDir;
+        if (!newDir.mkpath(dirs.at(i))) {
+            status.message = tr("Unable to create directory %1").arg(dirs.at(i));
+            zip_close(p_zip);
+            return status;
+        }
+    }
+
+    QString task = QString("extract:%1").arg(folder);
+    _progress->start(task, tr("Extracting %1 ...").arg(QFileInfo(folder).fileName()), false);
+    QAtomicInt done(0);
+    status = extractEntries(p_zip, entries, folder, task, &done, entries.size());
+    _progress->finish(task);
+    zip_close(p_zip);
+
+    return status;
+}
+
+Plugins::PluginStatus Plugins::installFolder(const QString &source,
+                                             const QString &folder,
+                                             bool cancellable)
+{
+    PluginStatus status;
+    status.success = true;
+
+    // the whole tree, not only the top level
+    QDir root(source);
+    QStringList dirs;
+    QStringList files;
+    dirs << folder;
+    QDirIterator it(source,
+                    QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot | QDir::NoSymLinks,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        QString name = root.relativeFilePath(it.filePath());
+        if (it.fileInfo().isDir()) { dirs << QString("%1/%2").arg(folder, name); }
+        else { files << name; }
+    }
+
+    // create directories up front, workers only copy files
+    for (int i = 0; i < dirs.size(); ++i) {
+        QDir newDir;
+        if (!newDir.mkpath(dirs.at(i))) {
+            status.message = tr("Unable to create directory %1").arg(dirs.at(i));
+            status.success = false;
+            return status;
+        }
+    }
+
+    bool store = getObjectStore();
+    QString task = QString("install:%1").arg(folder);
+    _progress->start(task, tr("Installing %1 ...").arg(QFileInfo(folder).fileName()), false);
+    QAtomicInt done(0);
+    int total = files.size();
+
+    int threads = getExtractThreads();
+    if (threads > total) { threads = total; }
+    if (threads < 2) {
+        status = installFiles(source, folder, files, store, cancellable, task, &done, total);
+    } else {
+        std::vector<std::function<PluginStatus()> > jobs;
+        QAtomicInt *counter = &done;
+        for (int i = 0; i < threads; ++i) {
+            QStringList partition;
+            for (int y = i; y < files.size(); y += threads) { partition << files.at(y); }
+            jobs.push_back([this, source, folder, partition, store, cancellable, task, counter, total]() {
+                return installFiles(source, folder, partition, store, cancellable, task, counter, total);
+            });
+        }
+        status = runWorkers(jobs);
+    }
+    _progress->finish(task);
+
+    return status;
+}
+
+Plugins::PluginStatus Plugins::runWorkers(const std::vector<std::function<Plugins::PluginStatus()> > &jobs)
+{
+    // a private pool, the caller may already be running in the global pool
+    PluginStatus status;
+    status.success = true;
+    QThreadPool pool;
+    pool.setMaxThreadCount(int(jobs.size()));
+    QList<QFuture<PluginStatus> > workers;
+    for (unsigned long i = 0; i < jobs.size(); ++i) { workers.append(QtConcurrent::run(&pool, jobs.at(i))); }
+    for (int i = 0; i < workers.size(); ++i) {
+        PluginStatus res = workers[i].result();
+        if (!res.success && status.success) { status = res; }
+    }
+    return status;
+}
+
+Plugins::PluginStatus Plugins::installFiles(const QString &source,
+                                            const QString &folder,
+                                            const QStringList &files,
+                                            bool store,
+                                            bool cancellable,
+                                            const QString &task,
+                                            QAtomicInt *done,
+                                            int total)
+{
+    PluginStatus status;
+    status.success = true;
+    for (int i = 0; i < files.size(); ++i) {
+        if (cancellable && isBatchCancelled()) {
+            status.message = tr("Cancelled");
             status.success = false;
             break;
         }
-        if (!(file_stat.valid & ZIP_STAT_NAME)) { continue; }
-        QString filePath = QString("%1/%2").arg(folder, file_stat.name);
+        _progress->update(task, done->fetchAndAddRelaxed(1), total);
+        QString fileSrc = QString("%1/%2").arg(source, files.at(i));
+        QString fileDst = QString("%1/%2").arg(folder, files.at(i));
+        // never hardlink, installed plug-ins are writable and must not share inodes with the cache
+        bool installed = store ? _objects->clone(fileSrc, fileDst) : copyFile(fileSrc, fileDst);
+        if (!installed) {
+            status.message = tr("Unable to copy file %1 to %2").arg(files.at(i), folder);
+            status.success = false;
+            break;
+        }
+    }
+    return status;
+}
 
-        //qDebug() << "EXTRACT" << filePath;
+bool Plugins::copyFile(const QString &source,
+                       const QString &dest)
+{
+    if (QFile::exists(dest)) { return false; }
+#ifdef Q_OS_LINUX
+    // let the kernel (or filesystem) copy, no data passes through us
+    int in = ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) { return false; }
+    struct stat st;
+    int out = -1;
+    if (fstat(in, &st) == 0) {
+        out = ::open(QFile::encodeName(dest).constData(),
+                     O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                     (st.st_mode & 0777) | S_IWUSR);
+    }
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+    bool copied = false;
+#ifdef FICLONE
+    copied = ioctl(out, FICLONE, in) == 0;
+#endif
+    if (!copied) {
+        copied = true;
+        off_t remaining = st.st_size;
+        while (remaining > 0) {
+            ssize_t bytes = copy_file_range(in, NULL, out, NULL, size_t(remaining), 0);
+            if (bytes <= 0) {
+                copied = false;
+                break;
+            }
+            remaining -= bytes;
+        }
+    }
+    ::close(out);
+    ::close(in);
+    if (copied) { return true; }
+    QFile::remove(dest); // not supported here, copy the usual way
+#endif
+    return QFile::copy(source, dest);
+}
 
-        if ((file_stat.name[0] != '\0') && (file_stat.name[strlen(file_stat.name)-1] == '/')) {
-            QDir newDir;
-            if (!newDir.mkpath(filePath)) {
-                status.message = tr("Unable to create directory %1").arg(filePath);
-                status.success = false;
+bool Plugins::linkFile(const QString &source,
+                       const QString &dest)
+{
+#ifdef Q_OS_UNIX
+    if (::link(QFile::encodeName(source).constData(),
+               QFile::encodeName(dest).constData()) == 0) { return true; }
+#endif
+    return copyFile(source, dest); // other filesystem
+}
+
+bool Plugins::swapFolder(const QString &staging,
+                         const QString &folder,
+                         const QString &keep)
+{
+    if (!QFile::exists(folder)) { return QFile::rename(staging, folder); }
+
+    // the old tree ends up in temp and is removed later, unless the caller keeps it
+    QString old = keep;
+    if (old.isEmpty()) { old = QString("%1/%2.old").arg(getTempPath(), getRandom(getTempPath(), ".old")); }
+#if defined(Q_OS_LINUX) && defined(RENAME_EXCHANGE)
+    if (renameat2(AT_FDCWD,
+                  QFile::encodeName(staging).constData(),
+                  AT_FDCWD,
+                  QFile::encodeName(folder).constData(),
+                  RENAME_EXCHANGE) == 0)
+    {
+        if (!QFile::rename(staging, old)) {
+            if (!keep.isEmpty()) { // caller expects the old tree in keep
+                renameat2(AT_FDCWD,
+                          QFile::encodeName(staging).constData(),
+                          AT_FDCWD,
+                          QFile::encodeName(folder).constData(),
+                          RENAME_EXCHANGE);
+                return false;
+            }
+            old = staging;
+        }
+        if (keep.isEmpty()) { _trash->discard(old); }
+        return true;
+    }
+#endif
+    // not atomic, but the folder is only missing between the renames
+    if (!QFile::rename(folder, old)) { return false; }
+    if (!QFile::rename(staging, folder)) {
+        QFile::rename(old, folder);
+        return false;
+    }
+    if (keep.isEmpty()) { _trash->discard(old); }
+    return true;
+}
+
+void Plugins::removeStaleFolders()
+{
+    // left behind if we were interrupted while extracting or swapping, trashed folders are reaped below
+    QStringList stale;
+    QDirIterator staging(getRepoPath(),
+                         QStringList() << "*.staging",
+                         QDir::Dirs | QDir::NoDotAndDotDot);
+    while (staging.hasNext()) { stale << staging.next(); }
+    QDirIterator old(getTempPath(),
+                     QStringList() << "*.old",
+                     QDir::Dirs | QDir::NoDotAndDotDot);
+    while (old.hasNext()) { stale << old.next(); }
+    QStringList userPaths;
+    userPaths << getUserPluginPath() << getUserAddonPath();
+    for (int i = 0; i < userPaths.size(); ++i) { // interrupted updates
+        QDirIterator update(userPaths.at(i),
+                            QStringList() << ".*.update",
+                            QDir::Dirs | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+        while (update.hasNext()) { stale << update.next(); }
+        // a kept previous version is the only copy if the swap did not complete
+        QDirIterator kept(userPaths.at(i),
+                          QStringList() << ".*.old",
+                          QDir::Dirs | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+        while (kept.hasNext()) {
+            QString path = kept.next();
+            QString target;
+            QString info = QString("%1%2").arg(path, PLUGINS_UPDATE_INFO_SUFFIX);
+            if (QFile::exists(info)) {
+                QSettings settings(info, QSettings::IniFormat);
+                target = settings.value(PLUGINS_UPDATE_KEY_PATH).toString();
+            }
+            if (target.isEmpty() || QFileInfo::exists(target) || !QFile::rename(path, target)) { stale << path; }
+        }
+        QDirIterator infos(userPaths.at(i),
+                           QStringList() << QString(".*.old%1").arg(PLUGINS_UPDATE_INFO_SUFFIX),
+                           QDir::Files | QDir::Hidden | QDir::System);
+        while (infos.hasNext()) { QFile::remove(infos.next()); }
+    }
+    for (int i = 0; i < stale.size(); ++i) { _trash->discard(stale.at(i)); }
+    _trash->reapInBackground(); // nothing to undo from the last session
+
+    // drop objects no longer linked from anywhere
+    if (ObjectStore::isSupported() && QFile::exists(getObjectStorePath())) {
+        ObjectStore *objects = _objects;
+        QFuture<void> f = QtConcurrent::run([objects]() { objects->prune(); });
+        Q_UNUSED(f)
+    }
+}
+
+void Plugins::unlinkPlugins(const QString &repoPath,
+                            const QString &replacement)
+{
+    // linked installs would dangle once their repository folder is gone, copy them
+    QString repo = QFileInfo(repoPath).canonicalFilePath();
+    if (repo.isEmpty()) { return; }
+    QStringList userPaths;
+    userPaths << getUserPluginPath() << getUserAddonPath();
+    for (int i = 0; i < userPaths.size(); ++i) {
+        QFileInfoList links = QDir(userPaths.at(i)).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (int y = 0; y < links.size(); ++y) {
+            if (!links.at(y).isSymLink()) { continue; }
+            QString target = links.at(y).canonicalFilePath();
+            if (!target.startsWith(QString("%1/").arg(repo))) { continue; }
+            QString folder = target.mid(repo.size() + 1);
+            if (!replacement.isEmpty() &&
+                QFile::exists(QString("%1/%2").arg(replacement, folder))) { continue; } // still there after the swap
+
+            QString link = links.at(y).filePath();
+            QString uid = getRandom(userPaths.at(i), ".update"); // swept at startup if interrupted
+            QString staging = QString("%1/.%2.update").arg(userPaths.at(i), uid);
+            bool copied = !uid.isEmpty() && installFolder(target, staging, false).success;
+            if (copied && QFile::remove(link)) {
+                if (QFile::rename(staging, link)) { continue; }
+                QFile::link(target, link);
+            }
+            if (QFile::exists(staging)) { _trash->discard(staging); }
+            emit statusError(tr("Unable to copy linked plug-in %1, it will be missing once the repository is replaced").arg(links.at(y).fileName()));
+        }
+    }
+}
+
+bool Plugins::storeRepoArchive(const Plugins::RepoSpecs &repo,
+                               const QByteArray &data,
+                               const QString &filename)
+{
+    QString archivePath = getRepoArchivePath(repo.id);
+    QString partPath = QString("%1.part").arg(archivePath);
+    QFile::remove(partPath);
+    bool written = false;
+    if (!filename.isEmpty()) { written = QFile::rename(filename, partPath); }
+    else {
+        QFile part(partPath);
+        if (part.open(QIODevice::WriteOnly)) {
+            written = part.write(data) == data.size();
+            part.close();
+        }
+    }
+
+    // make sure we can read it before replacing the old archive
+    struct zip* p_zip = written ? openArchive(partPath, QByteArray()) : NULL;
+    if (p_zip == NULL) {
+        QFile::remove(partPath);
+        return false;
+    }
+    zip_close(p_zip);
+    QFile::remove(archivePath);
+    if (!QFile::rename(partPath, archivePath)) { return false; }
+
+    // no longer needed in archive storage
+    unlinkPlugins(getRepoPath(repo.id));
+    QStringList unused;
+    unused << getRepoIconsPath(repo.id) << getRepoPath(repo.id);
+    for (int i = 0; i < unused.size(); ++i) {
+        if (QFile::exists(unused.at(i))) { _trash->discard(unused.at(i)); }
+    }
+    QFile::remove(getRepoIndexPath(repo.id));
+    QFile::remove(getRepoExtractTablePath(repo.id));
+    _localFiles.remove(repo.id);
+    return true;
+}
+
+const QStringList Plugins::getArchivePluginRoots(const QStringList &names)
+{
+    // Folder/Folder.py, or an add-on with __init__.py and README.md
+    QStringList roots;
+    QStringList inits;
+    QSet<QString> readmes;
+    for (int i = 0; i < names.size(); ++i) {
+        const QString &name = names.at(i);
+        int slash = name.lastIndexOf("/");
+        if (slash < 1) { continue; }
+        QString root = name.left(slash + 1);
+        QString file = name.mid(slash + 1);
+        if (file == QString("%1.py").arg(root.section("/", -2, -2))) { roots << root; }
+        else if (file == "__init__.py") { inits << root; }
+        else if (file == "README.md") { readmes.insert(root); }
+    }
+    for (int i = 0; i < inits.size(); ++i) {
+        if (readmes.contains(inits.at(i))) { roots << inits.at(i); }
+    }
+    roots.removeDuplicates();
+    return roots;
+}
+
+bool Plugins::isInArchivePluginRoot(const QString &name,
+                                    const QSet<QString> &roots)
+{
+    // look up each parent folder instead of comparing with every root
+    int slash = name.indexOf("/");
+    while (slash > 0) {
+        if (roots.contains(name.left(slash + 1))) { return true; }
+        slash = name.indexOf("/", slash + 1);
+    }
+    return false;
+}
+
+const QStringList Plugins::filterArchivePluginRoots(struct zip *p_zip,
+                                                    const std::vector<Plugins::ArchiveEntrySpecs> &entries,
+                                                    const QStringList &roots,
+                                                    const QStringList &groups)
+{
+    // read the group from the plug-in or add-on files without extracting
+    QHash<QString, quint64> indexes; // name, index
+    for (unsigned long e = 0; e < entries.size(); ++e) { indexes.insert(entries.at(e).name, entries.at(e).index); }
+    QStringList result;
+    for (int i = 0; i < roots.size(); ++i) {
+        const QString &root = roots.at(i);
+        QString pyName = QString("%1%2.py").arg(root, root.section("/", -2, -2));
+        QString readmeName = QString("%1README.md").arg(root);
+        QString group;
+        if (indexes.contains(pyName)) {
+            QByteArray py = readArchiveEntry(p_zip, indexes.value(pyName));
+            group = getValueFromData("getGrouping():", py).replace("Community/", "");
+        }
+        if (group.isEmpty() && indexes.contains(readmeName)) { // add-on
+            QByteArray readme = readArchiveEntry(p_zip, indexes.value(readmeName));
+            QTextStream in(&readme);
+            while (!in.atEnd()) {
+                QString line = in.readLine();
+                if (line.startsWith("[//]: # (GROUP :")) {
+                    group = line.split(":").takeLast().replace(")", "").trimmed();
+                    break;
+                }
+            }
+        }
+        for (int g = 0; g < groups.size(); ++g) {
+            if (group == groups.at(g) || group.startsWith(QString("%1/").arg(groups.at(g)))) {
+                result << root;
                 break;
             }
+        }
+    }
+    return result;
+}
+
+QByteArray Plugins::readArchiveEntry(struct zip *p_zip,
+                                     quint64 index)
+{
+    QByteArray result;
+    struct zip_file* p_file = zip_fopen_index(p_zip, index, 0);
+    if (p_file == NULL) { return result; }
+    char buffer[ZIP_BUF_SIZE];
+    zip_int64_t bytes_read;
+    while ((bytes_read = zip_fread(p_file, buffer, ZIP_BUF_SIZE)) > 0) {
+        result.append(buffer, bytes_read);
+    }
+    zip_fclose(p_file);
+    return result;
+}
+
+Plugins::PluginStatus Plugins::extractArchive(struct zip *p_zip,
+                                              const QString &filename,
+                                              const QString &folder,
+                                              const QByteArray &data,
+                                              bool selective,
+                                              const QString &table,
+                                              const QString &previous)
+{
+    PluginStatus status;
+    status.success = true;
+
+    // read the central directory once
+    std::vector<ArchiveEntrySpecs> entries;
+    QStringList dirNames;
+    zip_int64_t n_entries = zip_get_num_entries(p_zip, 0);
+    for (zip_int64_t entry_idx=0; entry_idx < n_entries; entry_idx++) {
+        struct zip_stat file_stat;
+        if (zip_stat_index(p_zip, entry_idx, 0, &file_stat)) {
+            status.message = tr("Failed to read file from %1").arg(filename);
+            status.success = false;
+            return status;
+        }
+        if (!(file_stat.valid & ZIP_STAT_NAME) || file_stat.name[0] == '\0') { continue; }
+        QString name = QString::fromUtf8(file_stat.name);
+        if (name.endsWith("/")) {
+            dirNames << name;
             continue;
         }
+        ArchiveEntrySpecs entry;
+        entry.index = entry_idx;
+        entry.name = name;
+        if (file_stat.valid & ZIP_STAT_SIZE) { entry.size = file_stat.size; }
+        if (file_stat.valid & ZIP_STAT_CRC) {
+            entry.crc = file_stat.crc;
+            entry.hasCrc = true;
+        }
+        entries.push_back(entry);
+    }
+
+    if (selective) { // only plug-in folders, optionally in selected groups
+        QStringList names;
+        for (unsigned long i = 0; i < entries.size(); ++i) { names << entries.at(i).name; }
+        QStringList roots = getArchivePluginRoots(names);
+        QStringList groups = getExtractGroups();
+        if (groups.size() > 0) { roots = filterArchivePluginRoots(p_zip, entries, roots, groups); }
+        QSet<QString> rootSet(roots.begin(), roots.end());
+        std::vector<ArchiveEntrySpecs> selected;
+        for (unsigned long i = 0; i < entries.size(); ++i) {
+            if (isInArchivePluginRoot(entries.at(i).name, rootSet)) { selected.push_back(entries.at(i)); }
+        }
+        entries = selected;
+        QStringList selectedDirs;
+        for (int i = 0; i < dirNames.size(); ++i) {
+            if (isInArchivePluginRoot(dirNames.at(i), rootSet)) { selectedDirs << dirNames.at(i); }
+        }
+        dirNames = selectedDirs;
+    }
+
+    // incremental, entries that didn't change since last time are linked from the previous tree
+    std::vector<ArchiveEntrySpecs> wanted = entries;
+    std::vector<ArchiveEntrySpecs> unchanged;
+    if (!table.isEmpty() && !previous.isEmpty()) {
+        QHash<QString, FileSpecs> known;
+        QFile cache(table);
+        if (cache.open(QIODevice::ReadOnly)) {
+            known = readFileIndex(cache.readAll());
+            cache.close();
+        }
+        std::vector<ArchiveEntrySpecs> changed;
+        for (unsigned long i = 0; i < entries.size(); ++i) {
+            if (isExtractedEntry(previous, entries.at(i), known.value(entries.at(i).name))) { unchanged.push_back(entries.at(i)); }
+            else { changed.push_back(entries.at(i)); }
+        }
+        entries = changed;
+    }
+
+    // create directories up front, workers only write files
+    QStringList dirs;
+    for (int i = 0; i < dirNames.size(); ++i) { dirs << QString("%1/%2").arg(folder, dirNames.at(i)); }
+    for (unsigned long i = 0; i < wanted.size(); ++i) {
+        int slash = wanted.at(i).name.lastIndexOf("/");
+        if (slash > 0) { dirs << QString("%1/%2").arg(folder, wanted.at(i).name.left(slash)); }
+    }
+    dirs.removeDuplicates();
+    for (int i = 0; i < dirs.size(); ++i) {
+        QDir newDir;
+        if (!newDir.mkpath(dirs.at(i))) {
+            status.message = tr("Unable to create directory %1").arg(dirs.at(i));
+            status.success = false;
+            return status;
+        }
+    }
+
+    // both trees are in the repository cache, nothing outside sees the shared files
+    for (unsigned long i = 0; i < unchanged.size(); ++i) {
+        if (!linkFile(QString("%1/%2").arg(previous, unchanged.at(i).name),
+                      QString("%1/%2").arg(folder, unchanged.at(i).name))) { entries.push_back(unchanged.at(i)); }
+    }
+
+    QString task = QString("extract:%1").arg(folder);
+    _progress->start(task, tr("Extracting %1 ...").arg(QFileInfo(folder).fileName()), false);
+    QAtomicInt done(0);
+    int total = entries.size();
+
+    int threads = getExtractThreads();
+    if (threads > total) { threads = total; }
+    if (threads < 2 || total < PLUGINS_EXTRACT_PARALLEL_MIN_ENTRIES) {
+        status = extractEntries(p_zip, entries, folder, task, &done, total);
+    } else {
+        // largest entries first, each to the least loaded worker
+        std::vector<ArchiveEntrySpecs> sorted = entries;
+        std::sort(sorted.begin(), sorted.end(), compareArchiveEntrySize);
+        std::vector<std::vector<ArchiveEntrySpecs> > partitions(threads);
+        std::vector<qint64> loads(threads, 0);
+        for (unsigned long i = 0; i < sorted.size(); ++i) {
+            long worker = std::min_element(loads.begin(), loads.end()) - loads.begin();
+            partitions.at(worker).push_back(sorted.at(i));
+            loads.at(worker) += sorted.at(i).size + 1;
+        }
+
+        std::vector<std::function<PluginStatus()> > jobs;
+        QAtomicInt *counter = &done;
+        for (unsigned long i = 0; i < partitions.size(); ++i) {
+            std::vector<ArchiveEntrySpecs> partition = partitions.at(i);
+            jobs.push_back([this, filename, data, partition, folder, task, counter, total]() {
+                return extractArchiveWorker(filename, data, partition, folder, task, counter, total);
+            });
+        }
+        status = runWorkers(jobs);
+    }
+    _progress->finish(task);
+
+    if (status.success && getObjectStore()) {
+        QStringList written;
+        for (unsigned long i = 0; i < entries.size(); ++i) { written << QString("%1/%2").arg(folder, entries.at(i).name); }
+        _objects->addFiles(written);
+    }
+
+    // remember what we wrote, stat after linking as that may change mtime
+    if (status.success && !table.isEmpty()) {
+        QHash<QString, FileSpecs> extracted;
+        for (unsigned long i = 0; i < wanted.size(); ++i) {
+            if (!wanted.at(i).hasCrc) { continue; }
+            QFileInfo info(QString("%1/%2").arg(folder, wanted.at(i).name));
+            if (!info.isFile()) { continue; }
+            FileSpecs file;
+            file.path = wanted.at(i).name;
+            file.size = info.size();
+            file.modified = info.lastModified().toMSecsSinceEpoch();
+            file.crc = wanted.at(i).crc;
+            extracted.insert(file.path, file);
+        }
+        if (!writeFileIndex(table, extracted)) { QFile::remove(table); }
+    }
+
+    return status;
+}
+
+bool Plugins::isExtractedEntry(const QString &folder,
+                               const Plugins::ArchiveEntrySpecs &entry,
+                               const Plugins::FileSpecs &known)
+{
+    if (!entry.hasCrc || known.path.isEmpty()) { return false; }
+    if (known.crc != entry.crc || known.size != entry.size) { return false; }
+    QFileInfo info(QString("%1/%2").arg(folder, entry.name));
+    return info.isFile() &&
+           info.size() == known.size &&
+           info.lastModified().toMSecsSinceEpoch() == known.modified;
+}
+
+Plugins::PluginStatus Plugins::extractArchiveWorker(const QString &filename,
+                                                    const QByteArray &data,
+                                                    const std::vector<Plugins::ArchiveEntrySpecs> &entries,
+                                                    const QString &folder,
+                                                    const QString &task,
+                                                    QAtomicInt *done,
+                                                    int total)
+{
+    PluginStatus status;
+    struct zip* p_zip = openArchive(filename, data);
+    if (p_zip == NULL) {
+        status.message = tr("Failed to open %1").arg(filename);
+        return status;
+    }
+    status = extractEntries(p_zip, entries, folder, task, done, total);
+    zip_close(p_zip);
+    return status;
+}
+
+Plugins::PluginStatus Plugins::extractEntries(struct zip *p_zip,
+                                              const std::vector<Plugins::ArchiveEntrySpecs> &entries,
+                                              const QString &folder,
+                                              const QString &task,
+                                              QAtomicInt *done,
+                                              int total)
+{
+    PluginStatus status;
+    status.success = true;
+
+    struct zip_file* p_file = NULL;
+    zip_int64_t bytes_read;
+
+    // one per thread, kept between archives and only grown, large enough to write most entries at once
+    static thread_local QByteArray buffer;
+    qint64 bufferSize = ZIP_BUF_SIZE;
+    for (unsigned long i = 0; i < entries.size(); ++i) {
+        if (entries.at(i).size > bufferSize) { bufferSize = entries.at(i).size; }
+    }
+    if (bufferSize > PLUGINS_EXTRACT_BUFFER_MAX) { bufferSize = PLUGINS_EXTRACT_BUFFER_MAX; }
+    if (buffer.size() < bufferSize) { buffer.resize(int(bufferSize)); }
+
+    for (unsigned long i = 0; i < entries.size(); ++i) {
+        _progress->update(task, done->fetchAndAddRelaxed(1), total);
+        QString filePath = QString("%1/%2").arg(folder, entries.at(i).name);
+
+        //qDebug() << "EXTRACT" << filePath;
 
-        if ((p_file = zip_fopen_index(p_zip, entry_idx, 0)) == NULL) {
+        if ((p_file = zip_fopen_index(p_zip, entries.at(i).index, 0)) == NULL) {
             status.message = tr("Failed to extract file %1").arg(filePath);
             status.success = false;
             break;
         }
 
+        QFile::remove(filePath); // may be a (read-only) link to a stored object
         QFile output(filePath);
-        if (!output.open(QIODevice::WriteOnly)) {
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
             status.message = tr("Unable to write to file %1").arg(filePath);
             status.success = false;
             break;
         }
+#ifdef Q_OS_LINUX
+        // best effort, lets the filesystem allocate the file in one go
+        if (entries.at(i).size > 0) { posix_fallocate(output.handle(), 0, entries.at(i).size); }
+#endif
 
+        // fill the buffer before writing
+        qint64 pending = 0;
         do {
-            if ((bytes_read = zip_fread(p_file, buffer, ZIP_BUF_SIZE)) == -1) {
+            if ((bytes_read = zip_fread(p_file, buffer.data() + pending, buffer.size() - pending)) == -1) {
                 status.message = tr("Failed to extract file %1").arg(filePath);
                 status.success = false;
                 break;
             }
-            if (bytes_read > 0) { output.write(buffer, bytes_read); }
+            pending += bytes_read;
+            if (pending == buffer.size() || (bytes_read == 0 && pending > 0)) {
+                if (output.write(buffer.constData(), pending) != pending) {
+                    status.message = tr("Unable to write to file %1").arg(filePath);
+                    status.success = false;
+                    break;
+                }
+                pending = 0;
+            }
         } while(bytes_read > 0);
 
         output.close();
         zip_fclose(p_file);
         p_file = NULL;
+        if (!status.success) { break; }
     }
 
     if (p_file) {
         zip_fclose(p_file);
         p_file = NULL;
     }
-    if (p_zip) { zip_close(p_zip); }
 
     return status;
 }
 
+bool Plugins::isValidChecksum(const QString &checksum,
+                              const QByteArray &hash)
+{
+    QString expected = checksum.trimmed().toLower();
+    if (expected.isEmpty()) { return true; } // checksum is optional
+    return QString::fromLatin1(hash.toHex()) == expected;
+}
+
 bool Plugins::isValidRepository(const Plugins::RepoSpecs &repo)
 {
     if (repo.label.isEmpty() ||
-        repo.zip.isEmpty() ||
+        (repo.zip.isEmpty() && repo.plugins.size() < 1 && repo.catalog.isEmpty()) ||
         repo.manifest.isEmpty())
     { return false; }
     return true;
@@ -911,8 +2674,8 @@ bool Plugins::isValidRepository(const Plugins::RepoSpecs &repo)
 
 bool Plugins::addRepository(const QString &manifest)
 {
-    if (isValidManifest(manifest)) {
-        RepoSpecs repo = readManifest(manifest);
+    RepoSpecs repo = readManifest(manifest);
+    if (isValidManifest(repo)) {
         if (isValidRepository(repo)) {
             repo.id = genNewRepoID();
             repo.enabled = true;
@@ -924,6 +2687,7 @@ bool Plugins::addRepository(const QString &manifest)
                     manifestFile.close();
                 }
                 if (savedManifest) {
+                    writeManifestCache(manifestFile.fileName(), repo);
                     emit statusMessage(tr("Added new repository: %1").arg(repo.label));
                     _availableRepositories.push_back(repo);
                     return true;
@@ -937,6 +2701,7 @@ bool Plugins::addRepository(const QString &manifest)
 void Plugins::loadRepositories()
 {
     emit statusMessage(tr("Loading repositories ..."));
+    removeStaleFolders();
     _availableRepositories.clear();
     QSettings settings;
     if (settings.value(PLUGINS_SETTINGS_KEY_REPOS).isValid()) {
@@ -996,39 +2761,120 @@ void Plugins::saveRepositories(const std::vector<Plugins::RepoSpecs> &repos)
 void Plugins::checkRepositories(bool emitChanges,
                                 bool emitCache)
 {
-    emit statusMessage(tr("Checking repositories ..."));
-
-    _installedPlugins.clear();
-
-    scanForInstalledPlugins(getSystemPluginPaths());
-    scanForInstalledPlugins(getUserPluginPath(), true);
-    scanForInstalledPlugins(getNatronCustomPaths());
-    scanForInstalledPlugins(getUserAddonPath(), true);
+    if (isBatchRunning()) { // the batch installs from the cache, checked again when it's done
+        _checkPending = true;
+        return;
+    }
+    emit statusMessage(tr("Checking repositories ..."));
+    _refreshTimer.start();
 
+    _repoPlugins.clear();
     _availablePlugins.clear();
     _availablePluginUpdates.clear();
-    _downloadQueue.clear();
+
+    std::vector<QUrl> pendingDownloads; // keep plug-ins waiting to be installed and repository updates
+    for (unsigned long i = 0; i < _downloadQueue.size(); ++i) {
+        QUrl url = _downloadQueue.at(i);
+        if (_pendingPlugins.contains(getRepoPluginFromUrl(getRepoFromUrl(url), url).id) ||
+            _deltaFiles.contains(url.toString())) {
+            pendingDownloads.push_back(url);
+        }
+    }
+    _downloadQueue = pendingDownloads;
 
     if (_availableRepositories.size() < 1) {
         qDebug() << "got no repos!!!";
+        scanForInstalledPlugins();
         emit updatedPlugins();
         return;
     }
+
+    // walk every extracted repository once, in parallel with the installed plug-ins
+    std::vector<ScanSpecs> scans;
+    QHash<QString, int> scanIndex; // repo id, scan
+    for (unsigned long i = 0; i < _availableRepositories.size(); ++i) {
+        if (!_availableRepositories.at(i).catalog.isEmpty()) { // use the cached catalog if any
+            QFile catalog(getRepoCatalogPath(_availableRepositories.at(i).id));
+            if (catalog.open(QIODevice::ReadOnly)) {
+                QList<RepoPluginSpecs> plugins = readCatalog(catalog.readAll());
+                catalog.close();
+                if (plugins.size() > 0) { _availableRepositories[i].plugins = plugins; }
+            }
+        }
+        const auto repo = _availableRepositories.at(i);
+        if (!isValidRepository(repo) || !repo.enabled || repo.plugins.size() > 0 || getArchiveStorage() ||
+            (!repo.catalog.isEmpty() && !_checkedCatalogs.contains(repo.id))) { continue; }
+        ScanSpecs scan;
+        scan.repo = repo;
+        scan.path = getRepoPath(repo.id);
+        scanIndex.insert(repo.id, scans.size());
+        scans.push_back(scan);
+    }
+    QFuture<void> scanned = QtConcurrent::map(scans, [this](ScanSpecs &scan) {
+        scan.plugins = findPlugins(scan.path, scan.repo.label);
+        for (unsigned long i = 0; i < scan.plugins.size(); ++i) {
+            if (isValidPlugin(scan.plugins.at(i))) { scan.valid++; }
+        }
+    });
+    scanForInstalledPlugins();
+    scanned.waitForFinished();
+
     for (unsigned long i = 0; i < _availableRepositories.size(); ++i) {
         const auto repo = _availableRepositories.at(i);
         if (!isValidRepository(repo) || !repo.enabled) { continue; }
         QString repoPath = getRepoPath(repo.id);
         qDebug() << "repo path?" << repoPath;
-        if (folderHasPlugins(repoPath) < 1 && folderHasAddons(repoPath) < 1) {
+        if (!repo.logo.isEmpty()) { // the image cache lives in the main thread
+            QMetaObject::invokeMethod(_images,
+                                      "request",
+                                      Qt::QueuedConnection,
+                                      Q_ARG(QUrl, repo.logo),
+                                      Q_ARG(QSize, QSize()));
+        }
+        if (!repo.catalog.isEmpty() &&
+            !_checkedCatalogs.contains(repo.id) &&
+            std::find(_downloadQueue.begin(), _downloadQueue.end(), repo.catalog) == _downloadQueue.end())
+        { // refresh the catalog once per session
+            _downloadQueue.push_back(repo.catalog);
+        }
+        if (repo.plugins.size() > 0) { // manifest v2 or catalog, plug-ins are downloaded when needed
+            addRemotePlugins(repo);
+            if (emitChanges) { emit updatedPlugins(); }
+            if (emitCache) { emit updatedCache(); }
+        } else if (!repo.catalog.isEmpty() && !_checkedCatalogs.contains(repo.id)) {
+            emit statusMessage(tr("Need to download %1 catalog").arg(repo.label));
+        } else if (getArchiveStorage()) { // browse the zip, nothing is extracted
+            if (QFile::exists(getRepoArchivePath(repo.id))) {
+                scanArchiveForAvailablePlugins(repo, emitChanges, emitCache);
+            } else if (!repo.zip.isEmpty()) {
+                emit statusMessage(tr("Need to download %1 repository").arg(repo.label));
+                _downloadQueue.push_back(repo.zip);
+            }
+        } else if (!scanIndex.contains(repo.id) || scans.at(scanIndex.value(repo.id)).valid < 1) {
+            if (repo.zip.isEmpty()) { continue; }
             qDebug() << "repo has no plugins, try downloading zip";
             emit statusMessage(tr("Need to download %1 repository").arg(repo.label));
             _downloadQueue.push_back(repo.zip);
         } else {
-            scanForAvailablePlugins(repo, repoPath, true, emitChanges, emitCache);
+            const ScanSpecs &scan = scans.at(scanIndex.value(repo.id));
+            for (unsigned long j = 0; j < scan.plugins.size(); ++j) { // in repository order, first one wins
+                PluginSpecs plugin = scan.plugins.at(j);
+                plugin.repo = repo;
+                addAvailablePlugin(plugin);
+            }
+            if (emitChanges) { emit updatedPlugins(); }
+            if (emitCache) { emit updatedCache(); }
+            if (!repo.index.isEmpty() &&
+                !_checkedIndexes.contains(repo.id) &&
+                std::find(_downloadQueue.begin(), _downloadQueue.end(), repo.index) == _downloadQueue.end())
+            { // check for changes once per session
+                _downloadQueue.push_back(repo.index);
+            }
         }
     }
     emit statusMessage(tr("Done"));
     if (_downloadQueue.size() > 0) { emit downloadRequired(); }
+    else { reportRefreshFinished(); }
 }
 
 std::vector<Plugins::RepoSpecs> Plugins::getAvailableRepositories()
@@ -1043,6 +2889,11 @@ Plugins::RepoSpecs Plugins::getRepoFromUrl(const QUrl &url)
         if (!url.isEmpty() && url == repoUrl) { return _availableRepositories.at(i); }
         repoUrl = _availableRepositories.at(i).manifest;
         if (!url.isEmpty() && url == repoUrl) { return _availableRepositories.at(i); }
+        repoUrl = _availableRepositories.at(i).index;
+        if (!url.isEmpty() && url == repoUrl) { return _availableRepositories.at(i); }
+        repoUrl = _availableRepositories.at(i).catalog;
+        if (!url.isEmpty() && url == repoUrl) { return _availableRepositories.at(i); }
+        if (isRepoPlugin(_availableRepositories.at(i), url)) { return _availableRepositories.at(i); }
     }
     return RepoSpecs();
 }
@@ -1068,9 +2919,87 @@ bool Plugins::isRepoLogo(const Plugins::RepoSpecs &repo,
     return false;
 }
 
+bool Plugins::isRepoIndex(const Plugins::RepoSpecs &repo,
+                          const QUrl &url)
+{
+    if (!repo.index.isEmpty() && repo.index == url) { return true; }
+    return false;
+}
+
+bool Plugins::isRepoCatalog(const Plugins::RepoSpecs &repo,
+                            const QUrl &url)
+{
+    if (!repo.catalog.isEmpty() && repo.catalog == url) { return true; }
+    return false;
+}
+
+bool Plugins::isValidRepoPlugin(const Plugins::RepoPluginSpecs &plugin)
+{
+    bool validFolder = !plugin.folder.isEmpty() &&
+                       !plugin.folder.contains("/") &&
+                       !plugin.folder.contains("\\") &&
+                       plugin.folder != "." &&
+                       plugin.folder != "..";
+    if (!plugin.id.isEmpty() &&
+        !plugin.label.isEmpty() &&
+        !plugin.group.isEmpty() &&
+        !plugin.zip.isEmpty() &&
+        plugin.version > 0 &&
+        validFolder) { return true; }
+    return false;
+}
+
+bool Plugins::isRepoPlugin(const Plugins::RepoSpecs &repo,
+                           const QUrl &url)
+{
+    return !getRepoPluginFromUrl(repo, url).zip.isEmpty();
+}
+
+Plugins::RepoPluginSpecs Plugins::getRepoPluginFromUrl(const Plugins::RepoSpecs &repo,
+                                                       const QUrl &url)
+{
+    if (url.isEmpty()) { return RepoPluginSpecs(); }
+    for (int i = 0; i < repo.plugins.size(); ++i) {
+        if (repo.plugins.at(i).zip == url) { return repo.plugins.at(i); }
+    }
+    return RepoPluginSpecs();
+}
+
 bool Plugins::isBusy()
 {
-    return _isWorking || _isDownloading;
+    return _isWorking || _isDownloading || _pendingRetries > 0 || isBatchRunning() || _indexingRepos.size() > 0 || _pendingJobs.size() > 0;
+}
+
+qint64 Plugins::getPeakMemoryUsage()
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef Q_OS_MAC
+        return usage.ru_maxrss; // bytes
+#else
+        return usage.ru_maxrss * 1024; // kilobytes
+#endif
+    }
+#endif
+    return -1;
+}
+
+void Plugins::reportRefreshFinished()
+{
+    if (!_refreshTimer.isValid() || _indexingRepos.size() > 0) { return; }
+    qint64 elapsed = _refreshTimer.elapsed();
+    qint64 peakMemory = getPeakMemoryUsage();
+    qDebug() << "repositories refreshed in" << elapsed << "ms"
+             << "peak memory" << QLocale().formattedDataSize(peakMemory);
+    _refreshTimer.invalidate();
+    emit refreshFinished(elapsed, peakMemory);
+}
+
+void Plugins::retryDownloads()
+{
+    _pendingRetries--;
+    startDownloads();
 }
 
 void Plugins::startDownloads()
@@ -1078,13 +3007,24 @@ void Plugins::startDownloads()
     if (_isDownloading || _downloadQueue.size() < 1) { return; }
     QUrl url = _downloadQueue.front();
     if (url.isEmpty()) { return; }
-    qDebug() << "download" << url;
-    QNetworkRequest request(url);
+    QUrl mirror = getDownloadMirror(url);
+    if (mirror.isEmpty()) { return; }
+    qDebug() << "download" << url << mirror;
+    QNetworkRequest request(mirror);
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
     request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
 #endif
     QNetworkReply *reply = _nam->get(request);
     reply->setProperty("url", url.toString());
+    reply->setProperty("mirror", mirror.toString());
+    _isDownloading = true;
+    _progress->start(url.toString(), tr("Downloading %1 ...").arg(url.fileName()));
+
+    DownloadSpecs specs;
+    specs.url = url;
+    specs.hash = QSharedPointer<QCryptographicHash>(new QCryptographicHash(QCryptographicHash::Sha256));
+    _downloads.insert(reply, specs);
+
     connect(reply,
             SIGNAL(readyRead()),
             this,
@@ -1099,6 +3039,68 @@ void Plugins::startDownloads()
             SLOT(handleDownloadProgress(qint64,qint64)));
 }
 
+const std::vector<QUrl> Plugins::getDownloadMirrors(const QUrl &url)
+{
+    std::vector<QUrl> mirrors;
+    if (url.isEmpty()) { return mirrors; }
+    mirrors.push_back(url);
+    RepoSpecs repo = getRepoFromUrl(url);
+    if (isRepoZip(repo, url)) {
+        for (unsigned long i = 0; i < repo.mirrors.size(); ++i) {
+            if (!repo.mirrors.at(i).isEmpty()) { mirrors.push_back(repo.mirrors.at(i)); }
+        }
+    }
+    // healthy mirrors first, manifest order is kept on ties
+    std::stable_sort(mirrors.begin(), mirrors.end(), [this](const QUrl &a, const QUrl &b) {
+        return _mirrorFailures.value(a.toString()) < _mirrorFailures.value(b.toString());
+    });
+    return mirrors;
+}
+
+const QUrl Plugins::getDownloadMirror(const QUrl &url)
+{
+    RetrySpecs &retry = _downloadRetries[url.toString()];
+    if (!retry.mirror.isEmpty()) { return retry.mirror; }
+    const auto mirrors = getDownloadMirrors(url);
+    for (unsigned long i = 0; i < mirrors.size(); ++i) {
+        if (retry.failed.contains(mirrors.at(i).toString())) { continue; }
+        retry.mirror = mirrors.at(i);
+        break;
+    }
+    return retry.mirror;
+}
+
+bool Plugins::isTransientNetworkError(QNetworkReply::NetworkError error)
+{
+    switch (error) {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::SslHandshakeFailedError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::UnknownNetworkError:
+    case QNetworkReply::ProxyConnectionClosedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::InternalServerError:
+    case QNetworkReply::ServiceUnavailableError:
+    case QNetworkReply::UnknownServerError:
+        return true;
+    default:;
+    }
+    return false;
+}
+
+int Plugins::getRetryDelay(int attempt)
+{
+    int delay = PLUGINS_DOWNLOAD_RETRY_DELAY;
+    for (int i = 0; i < attempt && delay < PLUGINS_DOWNLOAD_RETRY_DELAY_MAX; ++i) { delay *= 2; }
+    if (delay > PLUGINS_DOWNLOAD_RETRY_DELAY_MAX) { delay = PLUGINS_DOWNLOAD_RETRY_DELAY_MAX; }
+    // jitter between half and full delay so nodes don't retry in lockstep
+    return delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+}
+
 void Plugins::removeFromDownloadQueue(const QUrl &url)
 {
     int pos = -1;
@@ -1113,9 +3115,13 @@ void Plugins::removeFromDownloadQueue(const QUrl &url)
 
 bool Plugins::isValidManifest(const QString &manifest)
 {
-    RepoSpecs repo = readManifest(manifest);
-    if (repo.version >= 1.0 &&
-        !repo.zip.isEmpty() &&
+    return isValidManifest(readManifest(manifest));
+}
+
+bool Plugins::isValidManifest(const Plugins::RepoSpecs &repo)
+{
+    if (repo.version >= MANIFEST_VERSION_MIN &&
+        (!repo.zip.isEmpty() || repo.plugins.size() > 0 || !repo.catalog.isEmpty()) &&
         !repo.label.isEmpty() &&
         !repo.manifest.isEmpty()) { return true; }
     return false;
@@ -1123,72 +3129,111 @@ bool Plugins::isValidManifest(const QString &manifest)
 
 Plugins::RepoSpecs Plugins::readManifest(const QString &manifest)
 {
-    RepoSpecs repo;
-    if (getManifestVersion(manifest) >= 1.0) {
-        return parseManifestV1(manifest);
-    }
+    // one pass over the xml, then whatever the version needs
+    RepoSpecs repo = parseManifest(manifest);
+    if (repo.version < MANIFEST_VERSION_MIN) { return RepoSpecs(); }
+    if (repo.version < MANIFEST_VERSION_PLUGINS) { repo.plugins.clear(); }
     return repo;
 }
 
 Plugins::RepoSpecs Plugins::openManifest(const QString &filename)
 {
+    RepoSpecs repo;
+    if (readManifestCache(filename, repo)) { return repo; }
     QFile file(filename);
     if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         QString manifest = file.readAll();
         file.close();
-        return readManifest(manifest);
+        repo = readManifest(manifest);
+        if (isValidManifest(repo)) { writeManifestCache(filename, repo); }
+        return repo;
     }
     return RepoSpecs();
 }
 
-double Plugins::getManifestVersion(const QString &manifest)
-{
-    QXmlStreamReader xml(manifest);
-    if (xml.readNextStartElement()) {
-        if (xml.name() == QString(MANIFEST_TAG_ROOT)) {
-            while(xml.readNextStartElement()) {
-                if (xml.name() == QString(MANIFEST_TAG_VERSION)) {
-                    return xml.readElementText().toDouble();
-                }  else { xml.skipCurrentElement(); }
-            }
-        }
-    }
-    return 0.0;
-}
-
-Plugins::RepoSpecs Plugins::parseManifestV1(const QString &manifest)
+Plugins::ManifestElement Plugins::getManifestElement(const QXmlStreamReader &xml)
+{
+    static const QHash<QString, ManifestElement> elements = {
+        { QString(MANIFEST_TAG_VERSION), MANIFEST_ELEMENT_VERSION },
+        { QString(MANIFEST_TAG_TITLE), MANIFEST_ELEMENT_TITLE },
+        { QString(MANIFEST_TAG_URL), MANIFEST_ELEMENT_URL },
+        { QString(MANIFEST_TAG_MANIFEST), MANIFEST_ELEMENT_MANIFEST },
+        { QString(MANIFEST_TAG_LOGO), MANIFEST_ELEMENT_LOGO },
+        { QString(MANIFEST_TAG_ZIP), MANIFEST_ELEMENT_ZIP },
+        { QString(MANIFEST_TAG_MIRROR), MANIFEST_ELEMENT_MIRROR },
+        { QString(MANIFEST_TAG_INDEX), MANIFEST_ELEMENT_INDEX },
+        { QString(MANIFEST_TAG_FILES), MANIFEST_ELEMENT_FILES },
+        { QString(MANIFEST_TAG_CATALOG), MANIFEST_ELEMENT_CATALOG },
+        { QString(MANIFEST_TAG_CHECKSUM), MANIFEST_ELEMENT_CHECKSUM },
+        { QString(MANIFEST_TAG_MODIFIED), MANIFEST_ELEMENT_MODIFIED },
+        { QString(MANIFEST_TAG_PLUGIN), MANIFEST_ELEMENT_PLUGIN },
+        { QString(MANIFEST_TAG_ID), MANIFEST_ELEMENT_ID },
+        { QString(MANIFEST_TAG_LABEL), MANIFEST_ELEMENT_LABEL },
+        { QString(MANIFEST_TAG_GROUP), MANIFEST_ELEMENT_GROUP },
+        { QString(MANIFEST_TAG_FOLDER), MANIFEST_ELEMENT_FOLDER },
+        { QString(MANIFEST_TAG_DESCRIPTION), MANIFEST_ELEMENT_DESCRIPTION },
+        { QString(MANIFEST_TAG_ADDON), MANIFEST_ELEMENT_ADDON },
+        { QString(MANIFEST_TAG_SIZE), MANIFEST_ELEMENT_SIZE },
+        { QString(MANIFEST_TAG_ICON), MANIFEST_ELEMENT_ICON }
+    };
+    return elements.value(xml.name().toString(), MANIFEST_ELEMENT_UNKNOWN);
+}
+
+Plugins::RepoSpecs Plugins::parseManifest(const QString &manifest)
 {
     RepoSpecs repo;
+    repo.version = 0.0; // required
     QXmlStreamReader xml(manifest);
-    if (xml.readNextStartElement()) {
-        if (xml.name() == QString(MANIFEST_TAG_ROOT)) {
-            while(xml.readNextStartElement()) {
-                if (xml.name() == QString(MANIFEST_TAG_VERSION)) {
-                    QString version = xml.readElementText();
-                    repo.version = version.toDouble();
-                } else if (xml.name() == QString(MANIFEST_TAG_TITLE)) {
-                    QString title = xml.readElementText();
-                    repo.label = title;
-                } else if (xml.name() == QString(MANIFEST_TAG_URL)) {
-                    QString url = xml.readElementText();
-                    repo.url = QUrl::fromUserInput(url);
-                } else if (xml.name() == QString(MANIFEST_TAG_MANIFEST)) {
-                    QString manifest = xml.readElementText();
-                    repo.manifest = QUrl::fromUserInput(manifest);
-                } else if (xml.name() == QString(MANIFEST_TAG_LOGO)) {
-                    QString logo = xml.readElementText();
-                    repo.logo = QUrl::fromUserInput(logo);
-                } else if (xml.name() == QString(MANIFEST_TAG_ZIP)) {
-                    QString zip = xml.readElementText();
-                    repo.zip = QUrl::fromUserInput(zip);
-                } else if (xml.name() == QString(MANIFEST_TAG_CHECKSUM)) {
-                    QString checksum = xml.readElementText();
-                    repo.checksum = checksum;
-                } else if (xml.name() == QString(MANIFEST_TAG_MODIFIED)) {
-                    QString modified = xml.readElementText();
-                    repo.modified = QDateTime::fromString(modified,
-                                                          MANIFEST_MODIFIED_FORMAT);
-                } else { xml.skipCurrentElement(); }
+    if (xml.readNextStartElement() && xml.name() == QString(MANIFEST_TAG_ROOT)) {
+        while (xml.readNextStartElement()) {
+            switch (getManifestElement(xml)) {
+            case MANIFEST_ELEMENT_VERSION:
+                repo.version = xml.readElementText().toDouble();
+                break;
+            case MANIFEST_ELEMENT_TITLE:
+                repo.label = xml.readElementText();
+                break;
+            case MANIFEST_ELEMENT_URL:
+                repo.url = QUrl::fromUserInput(xml.readElementText());
+                break;
+            case MANIFEST_ELEMENT_MANIFEST:
+                repo.manifest = QUrl::fromUserInput(xml.readElementText());
+                break;
+            case MANIFEST_ELEMENT_LOGO:
+                repo.logo = QUrl::fromUserInput(xml.readElementText());
+                break;
+            case MANIFEST_ELEMENT_ZIP:
+                repo.zip = QUrl::fromUserInput(xml.readElementText());
+                break;
+            case MANIFEST_ELEMENT_MIRROR: {
+                QString mirror = xml.readElementText();
+                if (!mirror.isEmpty()) { repo.mirrors.push_back(QUrl::fromUserInput(mirror)); }
+                break;
+            }
+            case MANIFEST_ELEMENT_INDEX:
+                repo.index = QUrl::fromUserInput(xml.readElementText());
+                break;
+            case MANIFEST_ELEMENT_FILES:
+                repo.files = QUrl::fromUserInput(xml.readElementText());
+                break;
+            case MANIFEST_ELEMENT_CATALOG:
+                repo.catalog = QUrl::fromUserInput(xml.readElementText());
+                break;
+            case MANIFEST_ELEMENT_CHECKSUM:
+                repo.checksum = xml.readElementText();
+                break;
+            case MANIFEST_ELEMENT_MODIFIED:
+                repo.modified = QDateTime::fromString(xml.readElementText(),
+                                                      MANIFEST_MODIFIED_FORMAT);
+                break;
+            case MANIFEST_ELEMENT_PLUGIN: { // v2, dropped by readManifest for v1
+                RepoPluginSpecs plugin = parseManifestPlugin(xml);
+                if (isValidRepoPlugin(plugin)) { repo.plugins.append(plugin); }
+                else { qWarning() << "Invalid plug-in in manifest" << plugin.id; }
+                break;
+            }
+            default:
+                xml.skipCurrentElement();
             }
         }
     }
@@ -1199,6 +3244,142 @@ Plugins::RepoSpecs Plugins::parseManifestV1(const QString &manifest)
     return repo;
 }
 
+Plugins::RepoPluginSpecs Plugins::parseManifestPlugin(QXmlStreamReader &xml)
+{
+    RepoPluginSpecs plugin;
+    while (xml.readNextStartElement()) {
+        switch (getManifestElement(xml)) {
+        case MANIFEST_ELEMENT_ID:
+            plugin.id = xml.readElementText().trimmed();
+            break;
+        case MANIFEST_ELEMENT_LABEL:
+            plugin.label = xml.readElementText().trimmed();
+            break;
+        case MANIFEST_ELEMENT_VERSION:
+            plugin.version = xml.readElementText().toDouble();
+            break;
+        case MANIFEST_ELEMENT_GROUP:
+            plugin.group = xml.readElementText().trimmed();
+            break;
+        case MANIFEST_ELEMENT_FOLDER:
+            plugin.folder = xml.readElementText().trimmed();
+            break;
+        case MANIFEST_ELEMENT_DESCRIPTION:
+            plugin.desc = xml.readElementText().trimmed();
+            break;
+        case MANIFEST_ELEMENT_ADDON: {
+            QString addon = xml.readElementText().trimmed().toLower();
+            plugin.isAddon = (addon == "true" || addon == "1");
+            break;
+        }
+        case MANIFEST_ELEMENT_ZIP:
+            plugin.zip = QUrl::fromUserInput(xml.readElementText().trimmed());
+            break;
+        case MANIFEST_ELEMENT_SIZE:
+            plugin.size = xml.readElementText().toLongLong();
+            break;
+        case MANIFEST_ELEMENT_CHECKSUM:
+            plugin.checksum = xml.readElementText().trimmed();
+            break;
+        case MANIFEST_ELEMENT_ICON: {
+            QString icon = xml.readElementText().trimmed();
+            if (!icon.isEmpty()) { plugin.icon = QUrl::fromUserInput(icon); }
+            break;
+        }
+        default:
+            xml.skipCurrentElement();
+        }
+    }
+    return plugin;
+}
+
+const QString Plugins::getManifestCachePath(const QString &filename)
+{
+    if (filename.isEmpty() || filename.startsWith(":")) { return QString(); } // resources never change
+    return QString("%1%2").arg(filename, MANIFEST_CACHE_SUFFIX);
+}
+
+bool Plugins::readManifestCache(const QString &filename,
+                                Plugins::RepoSpecs &repo)
+{
+    QString cachePath = getManifestCachePath(filename);
+    if (cachePath.isEmpty() || !QFile::exists(cachePath)) { return false; }
+    QFileInfo info(filename);
+    QFile cache(cachePath);
+    if (!info.exists() || !cache.open(QIODevice::ReadOnly)) { return false; }
+
+    QDataStream in(&cache);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic = 0;
+    qint32 version = 0;
+    qint64 modified = 0;
+    qint64 size = 0;
+    in >> magic >> version >> modified >> size;
+    if (magic != MANIFEST_CACHE_MAGIC ||
+        version != MANIFEST_CACHE_VERSION ||
+        modified != info.lastModified().toMSecsSinceEpoch() ||
+        size != info.size()) { return false; } // changed or written by another version
+
+    RepoSpecs result;
+    quint32 mirrors = 0;
+    in >> result.version >> result.label >> result.url >> result.manifest >> result.logo >> result.zip;
+    in >> mirrors;
+    for (quint32 i = 0; i < mirrors && in.status() == QDataStream::Ok; ++i) {
+        QUrl mirror;
+        in >> mirror;
+        result.mirrors.push_back(mirror);
+    }
+    in >> result.index >> result.files >> result.catalog >> result.checksum >> result.modified;
+    quint32 plugins = 0;
+    in >> plugins;
+    for (quint32 i = 0; i < plugins && in.status() == QDataStream::Ok; ++i) {
+        RepoPluginSpecs plugin;
+        in >> plugin.id >> plugin.label >> plugin.version >> plugin.group >> plugin.folder >> plugin.desc;
+        in >> plugin.isAddon >> plugin.zip >> plugin.size >> plugin.checksum >> plugin.icon;
+        result.plugins.append(plugin);
+    }
+    if (in.status() != QDataStream::Ok) { return false; }
+    repo = result;
+    return true;
+}
+
+bool Plugins::writeManifestCache(const QString &filename,
+                                 const Plugins::RepoSpecs &repo)
+{
+    QString cachePath = getManifestCachePath(filename);
+    QFileInfo info(filename);
+    if (cachePath.isEmpty() || !info.exists()) { return false; }
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << quint32(MANIFEST_CACHE_MAGIC) << qint32(MANIFEST_CACHE_VERSION);
+    out << qint64(info.lastModified().toMSecsSinceEpoch()) << qint64(info.size());
+    out << repo.version << repo.label << repo.url << repo.manifest << repo.logo << repo.zip;
+    out << quint32(repo.mirrors.size());
+    for (unsigned long i = 0; i < repo.mirrors.size(); ++i) { out << repo.mirrors.at(i); }
+    out << repo.index << repo.files << repo.catalog << repo.checksum << repo.modified;
+    out << quint32(repo.plugins.size());
+    for (int i = 0; i < repo.plugins.size(); ++i) {
+        const RepoPluginSpecs &plugin = repo.plugins.at(i);
+        out << plugin.id << plugin.label << plugin.version << plugin.group << plugin.folder << plugin.desc;
+        out << plugin.isAddon << plugin.zip << plugin.size << plugin.checksum << plugin.icon;
+    }
+
+    // written aside and renamed, a reader never sees half a cache
+    QString partPath = QString("%1.part").arg(cachePath);
+    QFile part(partPath);
+    if (!part.open(QIODevice::WriteOnly)) { return false; }
+    bool written = part.write(data) == data.size();
+    part.close();
+    QFile::remove(cachePath);
+    if (!written || !QFile::rename(partPath, cachePath)) {
+        QFile::remove(partPath);
+        return false;
+    }
+    return true;
+}
+
 void Plugins::addDownloadUrl(const QUrl &url)
 {
     qDebug() << "add download" << url;
@@ -1261,6 +3442,14 @@ const QString Plugins::generateInitGuiPy()
             installedPlugins.push_back(plugin);
         }
     }
+    QFileInfoList links = QDir(getUserAddonPath()).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (int i = 0; i < links.size(); ++i) { // linked installs
+        if (!links.at(i).isSymLink() || !folderHasAddon(links.at(i).filePath())) { continue; }
+        PluginSpecs plugin = getAddonSpecs(links.at(i).filePath());
+        if (!hasPluginInList(plugin.id, installedPlugins)) {
+            installedPlugins.push_back(plugin);
+        }
+    }
 
     for (unsigned long i = 0; i < installedPlugins.size(); ++i) {
         PluginSpecs plugin = installedPlugins.at(i);
@@ -1285,84 +3474,501 @@ const QString Plugins::generateInitGuiPy()
     return output;
 }
 
+void Plugins::updateInitGuiPy()
+{
+    if (_isBatch.loadAcquire() == 1) { _initGuiPending.storeRelease(1); } // written once when the batch is done
+    else { writeInitGuiPy(generateInitGuiPy()); }
+}
+
 void Plugins::handleFileDownloaded(QNetworkReply *reply)
 {
-    emit statusMessage(tr("Done"));
     if (!reply) { return; }
+    if (reply->error() != QNetworkReply::NoError) {
+        handleDownloadFailure(reply);
+        return;
+    }
+    emit statusMessage(tr("Done"));
     QUrl url = reply->property("url").toString().isEmpty() ? reply->url() : QUrl::fromUserInput(reply->property("url").toString());
-    QByteArray fileData = reply->readAll();
+    if (_downloads.contains(reply) && !appendDownloadData(_downloads[reply], reply->readAll())) {
+        handleDownloadFailure(reply);
+        return;
+    }
+    _progress->finish(url.toString());
+    _mirrorFailures.remove(reply->property("mirror").toString());
+    _downloadRetries.remove(url.toString());
+    QByteArray fileData;
+    QByteArray fileHash;
+    QString fileName; // set if the download was spooled to disk
+    qint64 fileSize = 0;
+    if (_downloads.contains(reply)) { // data and hash was streamed in handleDownloadReadyRead
+        DownloadSpecs specs = _downloads.take(reply);
+        if (specs.file) {
+            specs.file->close();
+            fileName = specs.file->fileName();
+            fileSize = specs.file->size();
+        }
+        fileData = specs.data;
+        fileHash = specs.hash->result();
+    } else {
+        fileData = reply->readAll();
+        fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Sha256);
+    }
+    if (fileName.isEmpty()) { fileSize = fileData.size(); }
     reply->deleteLater();
     _isDownloading = false;
     removeFromDownloadQueue(url);
 
     RepoSpecs repo = getRepoFromUrl(url);
-    qDebug() << "download finished for repo" << repo.label << repo.id << fileData.size() << url;
-    if (fileData.size() > 0 && isValidRepository(repo)) { // we have data for a valid repo
-        if (isRepoZip(repo, url)) { // repo zip
-            QFile tempFile(QString("%1/%2.zip").arg(getTempPath(), getRandom()));
-            if (tempFile.open(QIODevice::WriteOnly)) {
-                tempFile.write(fileData);
-                tempFile.close();
+    qDebug() << "download finished for repo" << repo.label << repo.id << fileSize << url;
+    if (_deltaFiles.contains(url.toString())) { // changed file from a repo file index
+        handleRepoFileDownloaded(url, fileData, fileName, fileHash);
+    } else if (fileSize > 0 && isValidRepository(repo)) { // we have data for a valid repo
+        if (isRepoZip(repo, url) && !isValidChecksum(repo.checksum, fileHash)) { // corrupt repo zip
+            emit statusError(tr("Checksum mismatch for repository %1 archive").arg(repo.label));
+        } else if (isRepoZip(repo, url) && getArchiveStorage()) { // repo zip, kept as is
+            if (storeRepoArchive(repo, fileData, fileName)) {
+                emit statusMessage(tr("Done"));
+                saveRepositories(_availableRepositories);
+                scanArchiveForAvailablePlugins(repo);
+            } else {
+                emit statusError(tr("Failed to store repository %1 archive").arg(repo.label));
             }
+        } else if (isRepoZip(repo, url)) { // repo zip
+            // extract next to the live tree and swap when done, unchanged files are linked from the live tree
             QString destFolder = getRepoPath(repo.id);
-            qDebug() << "dest folder" << destFolder;
-            if (!destFolder.isEmpty() && !QFile::exists(destFolder)) {
-                QDir dir;
-                dir.mkpath(destFolder);
+            QString previousFolder = getExtractIncremental() && QFile::exists(destFolder) ? destFolder : QString();
+            QString stagingFolder = getRepoPath(QString("%1.staging").arg(repo.id));
+            qDebug() << "dest folder" << destFolder << stagingFolder;
+            QDir staging(stagingFolder);
+            if (!stagingFolder.isEmpty()) {
+                staging.removeRecursively();
+                staging.mkpath(stagingFolder);
             }
-            if (tempFile.exists() && QFile::exists(destFolder)) {
+            if (QFile::exists(stagingFolder)) {
                 emit statusMessage(tr("Extracting repository %1 ...").arg(repo.label));
-                PluginStatus res = extractPluginArchive(tempFile.fileName(), destFolder);
+                bool selective = getExtractSelective();
+                QString table = getRepoExtractTablePath(repo.id);
+                PluginStatus res = fileName.isEmpty() ?
+                                   extractPluginArchive(fileData, stagingFolder, selective, table, previousFolder) :
+                                   extractPluginArchive(fileName, stagingFolder, selective, table, previousFolder);
+                if (res.success && staging.entryList(QDir::AllEntries | QDir::NoDotAndDotDot).size() < 1) {
+                    res.success = false;
+                    res.message = tr("Repository %1 archive is empty").arg(repo.label);
+                }
+                if (res.success) { unlinkPlugins(destFolder, stagingFolder); } // folders left out of the new tree
+                if (res.success && !swapFolder(stagingFolder, destFolder)) {
+                    res.success = false;
+                    res.message = tr("Unable to replace repository %1").arg(repo.label);
+                }
                 if (res.success) {
                     emit statusMessage(tr("Done"));
+                    QFile::remove(getRepoArchivePath(repo.id)); // from archive storage
+                    if (previousFolder.isEmpty()) { // every file is new, linked files keep their size and mtime
+                        QFile::remove(getRepoIndexPath(repo.id));
+                        _localFiles.remove(repo.id);
+                    }
                     saveRepositories(_availableRepositories);
                     scanForAvailablePlugins(repo, destFolder, true);
                 } else {
+                    staging.removeRecursively();
+                    QFile::remove(table); // may describe the discarded tree
                     emit statusError(res.message);
                 }
-                tempFile.remove();
             } else {
                 emit statusError(tr("Failed to read/extract repository %1 archive").arg(repo.label));
             }
+        } else if (isRepoIndex(repo, url)) { // repo file index
+            handleRepoIndexDownloaded(repo, fileData);
+        } else if (isRepoCatalog(repo, url)) { // repo plug-in catalog
+            handleRepoCatalogDownloaded(repo, fileData);
+        } else if (isRepoPlugin(repo, url)) { // plug-in zip (manifest v2)
+            handlePluginDownloaded(repo, url, fileData, fileName, fileHash);
         } else if (isRepoManifest(repo, url)) { // repo manifest
             // TODO
             qDebug() << "downloaded repo manifest" << fileData;
         } else if (isRepoLogo(repo, url)) { // repo logo
-            // TODO
-            qDebug() << "downloaded repo logo" << fileData.size();
+            if (fileName.isEmpty()) { _images->insert(url, fileData); }
         } else { // unknown download
-            qWarning() << "Download is unknown and will be ignored" << fileData.size() << url;
-        }
-    } else if (isValidManifest(fileData)) { // new manifest
-        if (addRepository(fileData)) {
-            checkRepositories();
-            return;
+            qWarning() << "Download is unknown and will be ignored" << fileSize << url;
         }
+    } else if (addRepository(fileData)) { // new manifest
+        checkRepositories();
+        return;
     } else {
-        qWarning() << "Download is unknown and will be ignored" << fileData.size() << url;
+        qWarning() << "Download is unknown and will be ignored" << fileSize << url;
     }
+    if (!fileName.isEmpty()) { QFile::remove(fileName); }
     if (_downloadQueue.size() > 0) { emit downloadRequired(); }
+    else { reportRefreshFinished(); }
 }
 
-void Plugins::handleDownloadError(QNetworkReply::NetworkError /*error*/)
+void Plugins::handleRepoIndexDownloaded(const Plugins::RepoSpecs &repo,
+                                        const QByteArray &data)
+{
+    _checkedIndexes << repo.id;
+    QHash<QString, FileSpecs> remote = readFileIndex(data);
+    if (remote.isEmpty() || repo.files.isEmpty()) {
+        qWarning() << "Unable to use file index for repository" << repo.label;
+        return;
+    }
+
+    emit statusMessage(tr("Checking repository %1 for changes ...").arg(repo.label));
+    QString repoPath = getRepoPath(repo.id);
+
+    if (getExtractSelective()) { // same selection as when extracting the zip
+        QStringList roots = getArchivePluginRoots(remote.keys());
+        if (getExtractGroups().size() > 0) { // groups are unknown until downloaded, keep what we have
+            QStringList localRoots;
+            for (int i = 0; i < roots.size(); ++i) {
+                if (QFile::exists(QString("%1/%2").arg(repoPath, roots.at(i)))) { localRoots << roots.at(i); }
+            }
+            roots = localRoots;
+        }
+        QSet<QString> rootSet(roots.begin(), roots.end());
+        QHash<QString, FileSpecs> selected;
+        QHashIterator<QString, FileSpecs> s(remote);
+        while (s.hasNext()) {
+            s.next();
+            if (isInArchivePluginRoot(s.key(), rootSet)) { selected.insert(s.key(), s.value()); }
+        }
+        remote = selected;
+    }
+
+    // hashing the tree may take a while, continue here when done
+    _indexingRepos << repo.id;
+    QHash<QString, FileSpecs> cached = _localFiles.value(repo.id);
+    for (int i = _indexJobs.size() - 1; i >= 0; --i) {
+        if (_indexJobs.at(i).isFinished()) { _indexJobs.removeAt(i); }
+    }
+    _indexJobs << QtConcurrent::run([this, repo, remote, cached]() {
+        QHash<QString, FileSpecs> local = getLocalFileIndex(repo.id, cached);
+        QMetaObject::invokeMethod(this, [this, repo, remote, local]() {
+            _indexingRepos.removeAll(repo.id);
+            applyRepoIndex(repo, remote, local);
+            if (_downloadQueue.size() > 0) { emit downloadRequired(); }
+            else { reportRefreshFinished(); }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void Plugins::applyRepoIndex(const Plugins::RepoSpecs &repo,
+                             const QHash<QString, Plugins::FileSpecs> &remote,
+                             const QHash<QString, Plugins::FileSpecs> &local)
+{
+    QString repoPath = getRepoPath(repo.id);
+    _localFiles.insert(repo.id, local);
+
+    int removed = 0;
+    QHashIterator<QString, FileSpecs> l(local);
+    while (l.hasNext()) {
+        l.next();
+        if (remote.contains(l.key())) { continue; }
+        if (QFile::remove(QString("%1/%2").arg(repoPath, l.key()))) {
+            _localFiles[repo.id].remove(l.key());
+            removed++;
+        }
+    }
+
+    std::vector<FileSpecs> changed;
+    qint64 changedBytes = 0;
+    qint64 totalBytes = 0;
+    QHashIterator<QString, FileSpecs> r(remote);
+    while (r.hasNext()) {
+        r.next();
+        totalBytes += r.value().size;
+        if (local.value(r.key()).checksum == r.value().checksum) { continue; }
+        changed.push_back(r.value());
+        changedBytes += r.value().size;
+    }
+
+    if (changed.size() < 1) {
+        if (removed > 0) { finishRepoDelta(repo.id); }
+        else { emit statusMessage(tr("Repository %1 is up to date").arg(repo.label)); }
+        return;
+    }
+
+    if (!repo.zip.isEmpty() &&
+        totalBytes > 0 &&
+        changedBytes * 100 > totalBytes * PLUGINS_DELTA_MAX_CHANGED)
+    { // most of the repository changed, the zip is cheaper
+        _downloadQueue.push_back(repo.zip);
+        return;
+    }
+
+    QString basePath = repo.files.path();
+    while (basePath.endsWith("/")) { basePath.chop(1); }
+    for (unsigned long i = 0; i < changed.size(); ++i) {
+        QUrl url = repo.files;
+        url.setPath(QString("%1/%2").arg(basePath, changed.at(i).path));
+        DeltaSpecs delta;
+        delta.repo = repo.id;
+        delta.file = changed.at(i);
+        _deltaFiles.insert(url.toString(), delta);
+        _downloadQueue.push_back(url);
+    }
+    emit statusMessage(tr("Updating %1 file(s) in repository %2 ...").arg(changed.size()).arg(repo.label));
+}
+
+void Plugins::handleRepoFileDownloaded(const QUrl &url,
+                                       const QByteArray &data,
+                                       const QString &filename,
+                                       const QByteArray &hash)
+{
+    DeltaSpecs delta = _deltaFiles.take(url.toString());
+    QString filePath = QString("%1/%2").arg(getRepoPath(delta.repo), delta.file.path);
+    if (!isValidChecksum(delta.file.checksum, hash)) {
+        qWarning() << "Checksum mismatch for" << url;
+        finishRepoDelta(delta.repo);
+        return;
+    }
+
+    // write next to the old file and replace it when complete
+    QDir dir;
+    dir.mkpath(QFileInfo(filePath).absolutePath());
+    QString partPath = QString("%1.part").arg(filePath);
+    QFile::remove(partPath);
+    bool written = false;
+    if (!filename.isEmpty()) { written = QFile::rename(filename, partPath); }
+    else {
+        QFile part(partPath);
+        if (part.open(QIODevice::WriteOnly)) {
+            written = part.write(data) == data.size();
+            part.close();
+        }
+    }
+    if (written) {
+        QFile::remove(filePath);
+        written = QFile::rename(partPath, filePath);
+    }
+    if (written && getObjectStore()) { _objects->add(filePath); }
+
+    if (written) {
+        QFileInfo info(filePath);
+        FileSpecs file = delta.file;
+        file.size = info.size();
+        file.modified = info.lastModified().toMSecsSinceEpoch();
+        _localFiles[delta.repo].insert(file.path, file);
+    } else {
+        qWarning() << "Unable to write" << filePath;
+        QFile::remove(partPath);
+    }
+    finishRepoDelta(delta.repo);
+}
+
+void Plugins::finishRepoDelta(const QString &uid)
+{
+    QHashIterator<QString, DeltaSpecs> i(_deltaFiles);
+    while (i.hasNext()) {
+        i.next();
+        if (i.value().repo == uid) { return; } // still waiting for files
+    }
+    writeFileIndex(getRepoIndexPath(uid), _localFiles.value(uid));
+    emit statusMessage(tr("Repository updated"));
+    checkRepositories();
+}
+
+void Plugins::handleRepoCatalogDownloaded(const Plugins::RepoSpecs &repo,
+                                          const QByteArray &data)
+{
+    _checkedCatalogs << repo.id;
+    QList<RepoPluginSpecs> plugins = readCatalog(data);
+    if (plugins.size() < 1) {
+        qWarning() << "Unable to use plug-in catalog for repository" << repo.label;
+        if (repo.plugins.size() < 1 && !repo.zip.isEmpty()) { _downloadQueue.push_back(repo.zip); }
+        return;
+    }
+
+    QByteArray catalog = writeCatalog(plugins);
+    QFile cache(getRepoCatalogPath(repo.id));
+    if (cache.open(QIODevice::ReadOnly)) {
+        bool unchanged = cache.readAll() == catalog;
+        cache.close();
+        if (unchanged) { return; }
+    }
+    if (!cache.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Unable to write catalog" << cache.fileName();
+        return;
+    }
+    qint64 res = cache.write(catalog);
+    cache.close();
+    if (res > -1) { checkRepositories(); }
+}
+
+void Plugins::handlePluginDownloaded(const Plugins::RepoSpecs &repo,
+                                     const QUrl &url,
+                                     const QByteArray &data,
+                                     const QString &filename,
+                                     const QByteArray &hash)
+{
+    RepoPluginSpecs entry = getRepoPluginFromUrl(repo, url);
+    bool pending = _pendingPlugins.contains(entry.id);
+    bool update = _pendingPlugins.value(entry.id, false);
+    _pendingPlugins.remove(entry.id);
+
+    PluginStatus status;
+    QString repoPath = getRepoPath(repo.id);
+    QString pluginPath = QString("%1/%2").arg(repoPath, entry.folder);
+    if (!isValidChecksum(entry.checksum, hash)) {
+        status.message = tr("Checksum mismatch for plug-in %1 archive").arg(entry.label);
+    } else {
+        if (!QFile::exists(repoPath)) {
+            QDir dir;
+            dir.mkpath(repoPath);
+        }
+        // only the plug-in folder, nothing else in the archive may touch the repository
+        QString stagingPath = getRepoPath(QString("%1.%2.staging").arg(repo.id, entry.folder));
+        QDir(stagingPath).removeRecursively();
+        emit statusMessage(tr("Extracting plug-in %1 ...").arg(entry.label));
+        status = extractArchiveFolder(filename, data, QString("%1/").arg(entry.folder), stagingPath);
+        if (status.success && !swapFolder(stagingPath, pluginPath)) { // outdated copy is removed
+            status.success = false;
+            status.message = tr("Unable to replace plug-in %1").arg(entry.label);
+        }
+        if (!status.success) { QDir(stagingPath).removeRecursively(); }
+    }
+
+    if (status.success) {
+        PluginSpecs plugin = entry.isAddon ? getAddonSpecs(pluginPath) : getPluginSpecs(pluginPath);
+        plugin.repo = repo;
+        plugin.zip = entry.zip;
+        plugin.checksum = entry.checksum;
+        if (plugin.id != entry.id || !isValidPlugin(plugin)) {
+            status.success = false;
+            status.message = tr("Plug-in %1 archive does not contain %2").arg(entry.label, entry.folder);
+        } else { // replace the manifest entry with the downloaded plug-in
+            for (unsigned long i = 0; i < _availablePlugins.size(); ++i) {
+                if (_availablePlugins.at(i).id == plugin.id) { _availablePlugins[i] = plugin; }
+            }
+            for (unsigned long i = 0; i < _repoPlugins.size(); ++i) {
+                if (_repoPlugins.at(i).id == plugin.id && _repoPlugins.at(i).repo.id == repo.id) { _repoPlugins[i] = plugin; }
+            }
+            for (unsigned long i = 0; i < _availablePluginUpdates.size(); ++i) {
+                if (_availablePluginUpdates.at(i).id == plugin.id) { _availablePluginUpdates[i] = plugin; }
+            }
+            if (pending) { // reported when installed
+                startPendingPlugin(plugin.id, update);
+                return;
+            }
+        }
+    }
+
+    if (pending) { emit pendingPluginFinished(entry.id, update, status.success, status.message); }
+    else if (!status.success) { emit statusError(status.message); }
+}
+
+void Plugins::handleDownloadError(QNetworkReply::NetworkError error)
+{
+    // failures are handled in handleFileDownloaded when the reply is finished
+    qDebug() << "download error" << error;
+}
+
+void Plugins::handleDownloadFailure(QNetworkReply *reply)
 {
-    emit statusMessage(tr("Download failed"));
-    emit statusError(tr("Failed to download"));
     _isDownloading = false;
-    QNetworkReply *reply = qobject_cast<QNetworkReply*>(QObject::sender());
-    if (!reply) { return; }
     QUrl url = reply->property("url").toString().isEmpty() ? reply->url() : QUrl::fromUserInput(reply->property("url").toString());
-    removeFromDownloadQueue(url);
+    QString mirror = reply->property("mirror").toString();
+    QNetworkReply::NetworkError error = reply->error();
+    QString errorString = reply->errorString();
+    DownloadSpecs specs = _downloads.take(reply);
+    if (specs.file) { specs.file->remove(); }
     reply->deleteLater();
+
+    // a local write error, another attempt or mirror won't help
+    bool writeFailed = !specs.error.isEmpty();
+    if (writeFailed) { errorString = specs.error; }
+
+    qWarning() << "download failed" << url << mirror << errorString;
+    if (!writeFailed) { _mirrorFailures[mirror]++; }
+
+    RetrySpecs &retry = _downloadRetries[url.toString()];
+    if (!writeFailed && isTransientNetworkError(error) && retry.attempt < PLUGINS_DOWNLOAD_RETRIES) {
+        int delay = getRetryDelay(retry.attempt);
+        retry.attempt++;
+        emit statusMessage(tr("Download failed, retrying in %1 seconds ...").arg(delay / 1000.0, 0, 'f', 1));
+        _pendingRetries++; // busy until the retry has started
+        QTimer::singleShot(delay, this, SLOT(retryDownloads()));
+        return;
+    }
+
+    retry.attempt = 0;
+    retry.failed << mirror;
+    retry.mirror.clear();
+    if (!writeFailed && !getDownloadMirror(url).isEmpty()) { // fail over to next mirror
+        emit statusMessage(tr("Download failed, trying %1 ...").arg(retry.mirror.host()));
+        emit downloadRequired();
+        return;
+    }
+
+    _downloadRetries.remove(url.toString());
+    removeFromDownloadQueue(url);
+    _progress->finish(url.toString());
+    emit statusMessage(tr("Download failed"));
+    RepoSpecs repo = getRepoFromUrl(url);
+    QString pluginId = getRepoPluginFromUrl(repo, url).id;
+    if (_deltaFiles.contains(url.toString())) { // the file is fetched again on next check
+        finishRepoDelta(_deltaFiles.take(url.toString()).repo);
+    } else if (isRepoIndex(repo, url)) { // not critical, try again next session
+        _checkedIndexes << repo.id;
+    } else if (isRepoCatalog(repo, url)) { // use the cache or the zip
+        _checkedCatalogs << repo.id;
+        if (repo.plugins.size() < 1 && !repo.zip.isEmpty()) { _downloadQueue.push_back(repo.zip); }
+    } else if (_pendingPlugins.contains(pluginId)) {
+        emit pendingPluginFinished(pluginId,
+                                   _pendingPlugins.take(pluginId),
+                                   false,
+                                   tr("Failed to download %1: %2").arg(url.toString(), errorString));
+    } else {
+        emit statusError(tr("Failed to download %1: %2").arg(url.toString(), errorString));
+    }
     if (_downloadQueue.size() > 0) { emit downloadRequired(); }
+    else { reportRefreshFinished(); }
 }
 
 void Plugins::handleDownloadProgress(qint64 value, qint64 total)
 {
-    emit statusDownload(tr("Downloading, please wait ..."), value, total);
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    if (!reply) { return; }
+    _progress->update(reply->property("url").toString(), value, total);
 }
 
 void Plugins::handleDownloadReadyRead()
 {
     if (!_isDownloading) { _isDownloading = true; }
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    if (!reply || !_downloads.contains(reply)) { return; }
+    if (!appendDownloadData(_downloads[reply], reply->readAll())) { reply->abort(); } // handled as a failure
+}
+
+bool Plugins::appendDownloadData(Plugins::DownloadSpecs &specs,
+                                 const QByteArray &chunk)
+{
+    if (!specs.error.isEmpty()) { return false; }
+    if (chunk.isEmpty()) { return true; }
+    specs.hash->addData(chunk);
+    if (!specs.file &&
+        specs.data.size() + chunk.size() > PLUGINS_ARCHIVE_MEMORY_LIMIT)
+    { // too large to keep in memory, spool to disk
+        specs.file = QSharedPointer<QFile>(new QFile(QString("%1/%2.zip").arg(getTempPath(), getRandom())));
+        if (specs.file->open(QIODevice::WriteOnly)) {
+            if (specs.file->write(specs.data) != specs.data.size()) {
+                specs.error = tr("Unable to write %1: %2").arg(specs.file->fileName(), specs.file->errorString());
+                specs.file->remove();
+                return false;
+            }
+            specs.data.clear();
+        } else {
+            qWarning() << "Unable to spool download to" << specs.file->fileName();
+            specs.file.clear();
+        }
+    }
+    if (!specs.file) {
+        specs.data.append(chunk);
+        return true;
+    }
+    if (specs.file->write(chunk) != chunk.size()) { // disk full etc, don't keep a truncated archive
+        specs.error = tr("Unable to write %1: %2").arg(specs.file->fileName(), specs.file->errorString());
+        specs.file->remove();
+        return false;
+    }
+    return true;
 }
@@ -28,8 +28,26 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QDateTime>
+#include <QCryptographicHash>
+#include <QSharedPointer>
+#include <QHash>
+#include <QSet>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QList>
+#include <QXmlStreamReader>
+#include <QAtomicInt>
+#include <QThreadPool>
+#include <QFuture>
+#include <QCborStreamReader>
 
 #include <vector>
+#include <functional>
+
+#include "progress.h"
+#include "imagecache.h"
+#include "objectstore.h"
+#include "trash.h"
 
 #define DEFAULT_ICON ":/NatronPluginManager.png"
 
@@ -52,6 +70,34 @@
 #define PLUGINS_SETTINGS_USER_PATH "UserPluginPath"
 #define ADDONS_SETTINGS_USER_PATH "UserAddonPath"
 
+// extraction threads, 0 for one per core and 1 to disable
+#define PLUGINS_SETTINGS_EXTRACT_THREADS "ExtractThreads"
+
+// only extract plug-ins from repository archives, optionally limited to groups
+#define PLUGINS_SETTINGS_EXTRACT_SELECTIVE "ExtractSelective"
+#define PLUGINS_SETTINGS_EXTRACT_GROUPS "ExtractGroups"
+
+// only write files that changed when a repository is updated, the rest is linked into the staging folder
+#define PLUGINS_SETTINGS_EXTRACT_INCREMENTAL "ExtractIncremental"
+
+// keep repositories as the downloaded zip instead of extracting them
+#define PLUGINS_SETTINGS_ARCHIVE_STORAGE "ArchiveStorage"
+
+// store identical files once in the cache and link them
+#define PLUGINS_SETTINGS_OBJECT_STORE "ObjectStore"
+
+// how plug-ins are installed from the repository cache
+// copies share data with the cache through reflinks where supported,
+// linked folders track the repository and are excluded from updates
+#define PLUGINS_SETTINGS_INSTALL_MODE "InstallMode"
+#define PLUGINS_INSTALL_MODE_COPY 0
+#define PLUGINS_INSTALL_MODE_SYMLINK 2
+
+// written next to the previous version kept during an update,
+// restored at startup if the update was interrupted
+#define PLUGINS_UPDATE_INFO_SUFFIX ".info"
+#define PLUGINS_UPDATE_KEY_PATH "Path"
+
 #define MANIFEST_TAG_ROOT "repo"
 #define MANIFEST_TAG_VERSION "version"
 #define MANIFEST_TAG_TITLE "title"
@@ -59,9 +105,54 @@
 #define MANIFEST_TAG_MANIFEST "manifest"
 #define MANIFEST_TAG_LOGO "logo"
 #define MANIFEST_TAG_ZIP "zip"
+#define MANIFEST_TAG_MIRROR "mirror"
+#define MANIFEST_TAG_INDEX "index"
+#define MANIFEST_TAG_FILES "files"
+#define MANIFEST_TAG_CATALOG "catalog"
 #define MANIFEST_TAG_CHECKSUM "checksum"
 #define MANIFEST_TAG_MODIFIED "modified"
 #define MANIFEST_MODIFIED_FORMAT "yyyy-MM-dd HH:mm"
+#define MANIFEST_TAG_PLUGIN "plugin"
+#define MANIFEST_TAG_ID "id"
+#define MANIFEST_TAG_LABEL "label"
+#define MANIFEST_TAG_GROUP "group"
+#define MANIFEST_TAG_FOLDER "folder"
+#define MANIFEST_TAG_DESCRIPTION "description"
+#define MANIFEST_TAG_ADDON "addon"
+#define MANIFEST_TAG_SIZE "size"
+#define MANIFEST_TAG_ICON "icon"
+
+#define CATALOG_KEY_VERSION "version"
+#define CATALOG_KEY_PLUGINS "plugins"
+#define CATALOG_VERSION 1
+
+// manifest versions, plugin elements are only used from v2
+#define MANIFEST_VERSION_MIN 1.0
+#define MANIFEST_VERSION_PLUGINS 2.0
+
+// parsed manifest stored next to the xml, invalidated by its mtime and size
+#define MANIFEST_CACHE_SUFFIX ".cache"
+#define MANIFEST_CACHE_MAGIC 0x4e504d43
+#define MANIFEST_CACHE_VERSION 1
+
+// archives larger than this are spooled to disk while downloading
+#define PLUGINS_ARCHIVE_MEMORY_LIMIT 67108864
+
+// archives with less entries than this are extracted on one thread
+#define PLUGINS_EXTRACT_PARALLEL_MIN_ENTRIES 64
+
+// max size of the per thread extraction buffer, entries up to this size are written at once
+#define PLUGINS_EXTRACT_BUFFER_MAX 1048576
+
+// fetch the full zip instead of single files if more than this (%) changed
+#define PLUGINS_DELTA_MAX_CHANGED 50
+
+// retries per url/mirror on transient errors, delay doubles for each retry
+#define PLUGINS_DOWNLOAD_RETRIES 4
+#define PLUGINS_DOWNLOAD_RETRY_DELAY 1000
+#define PLUGINS_DOWNLOAD_RETRY_DELAY_MAX 30000
+
+struct zip;
 
 class Plugins : public QObject
 {
@@ -69,6 +160,20 @@ class Plugins : public QObject
 
 public:
 
+    struct RepoPluginSpecs { // manifest v2
+        QString id;
+        QString label;
+        double version = 0.0;
+        QString group;
+        QString folder;
+        QString desc;
+        bool isAddon = false;
+        QUrl zip;
+        qint64 size = 0;
+        QString checksum;
+        QUrl icon;
+    };
+
     struct RepoSpecs {
         double version = 1.0;
         QString label;
@@ -77,9 +182,14 @@ public:
         QUrl manifest;
         QUrl logo;
         QUrl zip;
+        std::vector<QUrl> mirrors;
+        QUrl index; // file index
+        QUrl files; // file index base url
+        QUrl catalog; // plug-in catalog
         QString checksum;
         QDateTime modified;
         bool enabled = false;
+        QList<RepoPluginSpecs> plugins; // manifest v2
     };
 
     struct PluginSpecs {
@@ -92,6 +202,7 @@ public:
         QString path;
         QString folder;
         bool writable = true;
+        bool linked = false; // folder linked to the repository cache
         QString readme;
         QString changes;
         QString authors;
@@ -99,13 +210,78 @@ public:
         QString modifier; // addons-only
         bool isAddon = false;
         RepoSpecs repo;
+        QUrl zip; // manifest v2
+        QString checksum; // manifest v2
+        QUrl iconUrl; // manifest v2
+        QString archive; // archive storage, folder in the repository zip
     };
 
     struct PluginStatus {
         bool success = false;
+        bool pending = false; // waiting for download
         QString message;
     };
 
+    struct DownloadSpecs {
+        QUrl url;
+        QByteArray data;
+        QSharedPointer<QFile> file;
+        QSharedPointer<QCryptographicHash> hash;
+        QString error; // set if spooling failed, the download is aborted
+    };
+
+    struct FileSpecs { // file index
+        QString path;
+        qint64 size = 0;
+        QString checksum;
+        qint64 modified = 0;
+        quint32 crc = 0;
+    };
+
+    struct DeltaSpecs {
+        QString repo;
+        Plugins::FileSpecs file;
+    };
+
+    struct ArchiveEntrySpecs {
+        quint64 index = 0;
+        QString name;
+        qint64 size = 0;
+        quint32 crc = 0;
+        bool hasCrc = false;
+    };
+
+    struct RetrySpecs {
+        int attempt = 0;
+        QUrl mirror;
+        QStringList failed;
+    };
+
+    enum ManifestElement {
+        MANIFEST_ELEMENT_UNKNOWN,
+        MANIFEST_ELEMENT_VERSION,
+        MANIFEST_ELEMENT_TITLE,
+        MANIFEST_ELEMENT_URL,
+        MANIFEST_ELEMENT_MANIFEST,
+        MANIFEST_ELEMENT_LOGO,
+        MANIFEST_ELEMENT_ZIP,
+        MANIFEST_ELEMENT_MIRROR,
+        MANIFEST_ELEMENT_INDEX,
+        MANIFEST_ELEMENT_FILES,
+        MANIFEST_ELEMENT_CATALOG,
+        MANIFEST_ELEMENT_CHECKSUM,
+        MANIFEST_ELEMENT_MODIFIED,
+        MANIFEST_ELEMENT_PLUGIN,
+        MANIFEST_ELEMENT_ID,
+        MANIFEST_ELEMENT_LABEL,
+        MANIFEST_ELEMENT_GROUP,
+        MANIFEST_ELEMENT_FOLDER,
+        MANIFEST_ELEMENT_DESCRIPTION,
+        MANIFEST_ELEMENT_ADDON,
+        MANIFEST_ELEMENT_SIZE,
+        MANIFEST_ELEMENT_ICON
+    };
+
     enum PluginType {
         NATRON_PLUGIN_TYPE_NONE,
         NATRON_PLUGIN_TYPE_AVAILABLE,
@@ -113,6 +289,21 @@ public:
         NATRON_PLUGIN_TYPE_UPDATE
     };
 
+    struct BatchSpecs {
+        QString id;
+        PluginType type = NATRON_PLUGIN_TYPE_NONE; // current state, decides the operation
+        PluginStatus status;
+        PluginSpecs installed; // copied from the lists before the worker touches any files
+        PluginSpecs plugin;
+    };
+
+    struct ScanSpecs {
+        RepoSpecs repo;
+        QString path;
+        std::vector<PluginSpecs> plugins;
+        int valid = 0;
+    };
+
     explicit Plugins(QObject *parent = nullptr);
     ~Plugins();
 
@@ -121,9 +312,15 @@ public:
                                  bool append = false,
                                  bool emitChanges = true,
                                  bool emitCache = false);
+    std::vector<Plugins::PluginSpecs> findPlugins(const QString &path,
+                                                  const QString &label = QString());
+    void scanArchiveForAvailablePlugins(const RepoSpecs &repo,
+                                        bool emitChanges = true,
+                                        bool emitCache = false);
     void scanForInstalledPlugins(const QStringList &paths);
     void scanForInstalledPlugins(const QString &path,
                                  bool append = false);
+    Plugins::PluginType patchPlugin(const QString &id);
 
     bool hasPlugin(const QString &id);
     bool hasAvailablePlugin(const QString &id);
@@ -149,22 +346,30 @@ public:
     const std::vector<Plugins::PluginSpecs> getPluginsInGroup(Plugins::PluginType type,
                                                               const QString &group);
 
+    const QString getValueFromDevice(const QString &key,
+                                     QIODevice *device,
+                                     bool toHtml = false);
     const QString getValueFromFile(const QString &key,
                                    const QString &filename,
                                    bool toHtml = false);
+    const QString getValueFromData(const QString &key,
+                                   const QByteArray &data,
+                                   bool toHtml = false);
 
     Plugins::PluginSpecs getPluginSpecs(const QString &path);
     Plugins::PluginSpecs getAddonSpecs(const QString &path);
+    void parsePluginPy(Plugins::PluginSpecs &specs,
+                       const QByteArray &py);
+    void parseAddonReadme(Plugins::PluginSpecs &specs,
+                          const QByteArray &readme);
 
     bool isValidPlugin(const Plugins::PluginSpecs &plugin);
     bool isValidAddon(const Plugins::PluginSpecs &addon);
 
+    Plugins::PluginSpecs getFolderSpecs(const QString &path);
     bool folderHasPlugin(const QString &path);
     bool folderHasAddon(const QString &path);
 
-    int folderHasPlugins(const QString &path);
-    int folderHasAddons(const QString &path);
-
     const QString getUserNatronPath();
 
     const QString getUserPluginPath();
@@ -173,6 +378,21 @@ public:
     const QString getUserAddonPath();
     void setUserAddonPath(const QString &path);
 
+    int getExtractThreads();
+    void setExtractThreads(int threads);
+    bool getExtractSelective();
+    void setExtractSelective(bool selective);
+    const QStringList getExtractGroups();
+    void setExtractGroups(const QStringList &groups);
+    bool getExtractIncremental();
+    void setExtractIncremental(bool incremental);
+    bool getArchiveStorage();
+    void setArchiveStorage(bool archive);
+    bool getObjectStore();
+    void setObjectStore(bool store);
+    int getInstallMode();
+    void setInstallMode(int mode);
+
     const QStringList getSystemPluginPaths();
     const QStringList getNatronCustomPaths();
     const QString getCachePath();
@@ -182,17 +402,84 @@ public:
     const QString getRandom(const QString &path = QString(),
                             const QString &suffix = QString());
     const QString getTempPath();
+    const QString getImageCachePath();
+    ImageCache* getImageCache();
+    const QString getObjectStorePath();
+    ObjectStore* getObjects();
+    const QString getTrashPath();
+    Trash* getTrash();
+    const QString getRepoIndexPath(const QString &uid);
+    const QString getRepoArchivePath(const QString &uid);
+    const QString getRepoIconsPath(const QString &uid);
+    const QString getRepoExtractTablePath(const QString &uid);
+
+    QHash<QString, Plugins::FileSpecs> readFileIndex(const QByteArray &data);
+    bool writeFileIndex(const QString &filename,
+                        const QHash<QString, Plugins::FileSpecs> &files);
+    QHash<QString, Plugins::FileSpecs> getLocalFileIndex(const QString &uid,
+                                                         const QHash<QString, Plugins::FileSpecs> &cached);
+
+    const QString getRepoCatalogPath(const QString &uid);
+    QList<Plugins::RepoPluginSpecs> readCatalog(const QByteArray &data);
+    QByteArray writeCatalog(const QList<Plugins::RepoPluginSpecs> &plugins);
 
     const QString genNewRepoID();
 
+    bool isPluginDownloaded(const Plugins::PluginSpecs &plugin);
+    Plugins::PluginStatus downloadPlugin(const Plugins::PluginSpecs &plugin,
+                                         bool update = false);
+
     Plugins::PluginStatus installPlugin(const QString &id,
                                         bool update = false);
+    Plugins::PluginStatus installPluginFiles(const Plugins::PluginSpecs &plugin,
+                                             const QString &destPath,
+                                             bool cancellable = false);
     Plugins::PluginStatus removePlugin(const QString &id);
+    Plugins::PluginStatus restorePlugin(const QString &id);
+    bool hasTrashedPlugin(const QString &id);
     Plugins::PluginStatus updatePlugin(const QString &id);
+    std::vector<Plugins::BatchSpecs> runBatch(const std::vector<Plugins::BatchSpecs> &batch);
+    bool startBatch(const std::vector<Plugins::BatchSpecs> &batch);
+    void cancelBatch();
+    bool isBatchRunning();
+    bool isBatchCancelled();
 
     Plugins::PluginStatus extractPluginArchive(const QString &filename,
                                                const QString &folder,
-                                               const QString &checksum = QString());
+                                               bool selective = false,
+                                               const QString &table = QString(),
+                                               const QString &previous = QString());
+    Plugins::PluginStatus extractPluginArchive(const QByteArray &data,
+                                               const QString &folder,
+                                               bool selective = false,
+                                               const QString &table = QString(),
+                                               const QString &previous = QString());
+    Plugins::PluginStatus extractArchiveFolder(const QString &filename,
+                                               const QByteArray &data,
+                                               const QString &root,
+                                               const QString &folder);
+    Plugins::PluginStatus installFolder(const QString &source,
+                                        const QString &folder,
+                                        bool cancellable = false);
+    bool copyFile(const QString &source,
+                  const QString &dest);
+    bool linkFile(const QString &source,
+                  const QString &dest);
+    bool swapFolder(const QString &staging,
+                    const QString &folder,
+                    const QString &keep = QString());
+    void removeStaleFolders();
+    void unlinkPlugins(const QString &repoPath,
+                       const QString &replacement = QString());
+    bool storeRepoArchive(const Plugins::RepoSpecs &repo,
+                          const QByteArray &data,
+                          const QString &filename);
+    const QStringList getArchivePluginRoots(const QStringList &names);
+    bool isInArchivePluginRoot(const QString &name,
+                               const QSet<QString> &roots);
+
+    bool isValidChecksum(const QString &checksum,
+                         const QByteArray &hash);
 
     bool isValidRepository(const RepoSpecs &repo);
     bool addRepository(const QString &manifest);
@@ -208,28 +495,54 @@ public:
                    const QUrl &url);
     bool isRepoLogo(const Plugins::RepoSpecs &repo,
                     const QUrl &url);
+    bool isRepoPlugin(const Plugins::RepoSpecs &repo,
+                      const QUrl &url);
+    bool isRepoIndex(const Plugins::RepoSpecs &repo,
+                     const QUrl &url);
+    bool isRepoCatalog(const Plugins::RepoSpecs &repo,
+                       const QUrl &url);
+    bool isValidRepoPlugin(const Plugins::RepoPluginSpecs &plugin);
+    Plugins::RepoPluginSpecs getRepoPluginFromUrl(const Plugins::RepoSpecs &repo,
+                                                  const QUrl &url);
 
     bool isBusy();
+    qint64 getPeakMemoryUsage();
+
+    const std::vector<QUrl> getDownloadMirrors(const QUrl &url);
+    const QUrl getDownloadMirror(const QUrl &url);
+    bool isTransientNetworkError(QNetworkReply::NetworkError error);
+    int getRetryDelay(int attempt);
 
     void removeFromDownloadQueue(const QUrl &url);
+    void scanForInstalledPlugins();
 
     bool isValidManifest(const QString &manifest);
+    bool isValidManifest(const Plugins::RepoSpecs &repo);
     Plugins::RepoSpecs readManifest(const QString &manifest);
     Plugins::RepoSpecs openManifest(const QString &filename);
 
-    double getManifestVersion(const QString &manifest);
+    Plugins::ManifestElement getManifestElement(const QXmlStreamReader &xml);
+    Plugins::RepoSpecs parseManifest(const QString &manifest);
+    Plugins::RepoPluginSpecs parseManifestPlugin(QXmlStreamReader &xml);
 
-    Plugins::RepoSpecs parseManifestV1(const QString &manifest);
+    const QString getManifestCachePath(const QString &filename);
+    bool readManifestCache(const QString &filename,
+                           Plugins::RepoSpecs &repo);
+    bool writeManifestCache(const QString &filename,
+                            const Plugins::RepoSpecs &repo);
 
     void addDownloadUrl(const QUrl &url);
 
     bool hasInitGuiPy();
     bool writeInitGuiPy(const QString &content);
     const QString generateInitGuiPy();
+    void updateInitGuiPy();
 
 signals:
 
     void updatedPlugins();
+    void updatedPlugin(const QString &id,
+                       int type);
     void updatedCache();
     void statusMessage(const QString &message);
     void statusDownload(const QString &message,
@@ -237,27 +550,159 @@ signals:
                         qint64 total);
     void statusError(const QString &message);
     void downloadRequired();
+    void batchItemStarted(const QString &id,
+                          int type);
+    void batchItemFinished(const QString &id,
+                           int type,
+                           bool success,
+                           bool pending,
+                           const QString &message);
+    void batchFinished(bool cancelled);
+    void pendingPluginFinished(const QString &id,
+                               bool update,
+                               bool success,
+                               const QString &message);
+    void refreshFinished(qint64 elapsed,
+                         qint64 peakMemory);
 
 private:
 
     bool _isWorking;
     bool _isDownloading;
+    int _pendingRetries; // failed downloads waiting for their backoff
+    QAtomicInt _isBatch;
+    QAtomicInt _initGuiPending;
+    QAtomicInt _batchRunning;
+    QAtomicInt _batchCancel;
+    bool _checkPending;
+    QThreadPool _batchPool;
+    QStringList _pendingJobs; // downloaded plug-ins being installed
+    std::vector<Plugins::PluginSpecs> _repoPlugins; // everything the repositories have
     std::vector<Plugins::PluginSpecs> _availablePlugins;
     std::vector<Plugins::PluginSpecs> _availablePluginUpdates;
     std::vector<Plugins::PluginSpecs> _installedPlugins;
     std::vector<Plugins::RepoSpecs> _availableRepositories;
     std::vector<QUrl> _downloadQueue;
+    QHash<QNetworkReply*, Plugins::DownloadSpecs> _downloads;
+    QHash<QString, Plugins::RetrySpecs> _downloadRetries;
+    QHash<QString, int> _mirrorFailures;
+    QHash<QString, bool> _pendingPlugins; // id, update
+    QHash<QString, Plugins::DeltaSpecs> _deltaFiles; // url, file
+    QHash<QString, QHash<QString, Plugins::FileSpecs> > _localFiles; // repo, files
+    QStringList _checkedIndexes;
+    QStringList _indexingRepos; // local files are hashed in the background
+    QList<QFuture<void> > _indexJobs; // waited for when we are destroyed
+    QStringList _checkedCatalogs;
     QNetworkAccessManager *_nam;
+    Progress *_progress;
+    ImageCache *_images;
+    ObjectStore *_objects;
+    Trash *_trash;
+    QElapsedTimer _refreshTimer;
+
+    struct zip* openArchive(const QString &filename,
+                            const QByteArray &data);
+    Plugins::PluginStatus extractArchive(struct zip *p_zip,
+                                         const QString &filename,
+                                         const QString &folder,
+                                         const QByteArray &data = QByteArray(),
+                                         bool selective = false,
+                                         const QString &table = QString(),
+                                         const QString &previous = QString());
+    bool isExtractedEntry(const QString &folder,
+                          const Plugins::ArchiveEntrySpecs &entry,
+                          const Plugins::FileSpecs &known);
+    const QStringList filterArchivePluginRoots(struct zip *p_zip,
+                                               const std::vector<Plugins::ArchiveEntrySpecs> &entries,
+                                               const QStringList &roots,
+                                               const QStringList &groups);
+    QByteArray readArchiveEntry(struct zip *p_zip,
+                                quint64 index);
+    Plugins::PluginStatus extractArchiveWorker(const QString &filename,
+                                               const QByteArray &data,
+                                               const std::vector<Plugins::ArchiveEntrySpecs> &entries,
+                                               const QString &folder,
+                                               const QString &task,
+                                               QAtomicInt *done,
+                                               int total);
+    Plugins::PluginStatus extractEntries(struct zip *p_zip,
+                                         const std::vector<Plugins::ArchiveEntrySpecs> &entries,
+                                         const QString &folder,
+                                         const QString &task,
+                                         QAtomicInt *done,
+                                         int total);
+    Plugins::PluginStatus runWorkers(const std::vector<std::function<Plugins::PluginStatus()> > &jobs);
+    Plugins::PluginStatus installFiles(const QString &source,
+                                       const QString &folder,
+                                       const QStringList &files,
+                                       bool store,
+                                       bool cancellable,
+                                       const QString &task,
+                                       QAtomicInt *done,
+                                       int total);
+    bool appendDownloadData(Plugins::DownloadSpecs &specs,
+                            const QByteArray &chunk);
+    void handleDownloadFailure(QNetworkReply *reply);
+    Plugins::PluginStatus prepareInstall(const QString &id,
+                                         bool update,
+                                         Plugins::PluginSpecs *plugin);
+    Plugins::PluginStatus prepareRemove(const QString &id,
+                                        Plugins::PluginSpecs *plugin);
+    Plugins::PluginStatus prepareUpdate(const QString &id,
+                                        Plugins::PluginSpecs *installed,
+                                        Plugins::PluginSpecs *plugin);
+    Plugins::PluginStatus installPluginFolder(const Plugins::PluginSpecs &plugin,
+                                              bool cancellable);
+    Plugins::PluginStatus removePluginFolder(const Plugins::PluginSpecs &plugin);
+    Plugins::PluginStatus updatePluginFolder(const Plugins::PluginSpecs &installed,
+                                             const Plugins::PluginSpecs &plugin);
+    Plugins::PluginStatus prepareBatchItem(Plugins::BatchSpecs &item);
+    Plugins::PluginStatus runBatchItem(const Plugins::BatchSpecs &item);
+    void runInOwnerThread(const std::function<void()> &func);
+    void startPendingPlugin(const QString &id,
+                            bool update);
+    void addAvailablePlugin(const Plugins::PluginSpecs &plugin);
+    void sortAvailablePlugin(const Plugins::PluginSpecs &plugin);
+    void removePluginEntries(std::vector<Plugins::PluginSpecs> &plugins,
+                             const QString &id);
+    void addRemotePlugins(const Plugins::RepoSpecs &repo);
+    void handleRepoIndexDownloaded(const Plugins::RepoSpecs &repo,
+                                   const QByteArray &data);
+    void applyRepoIndex(const Plugins::RepoSpecs &repo,
+                        const QHash<QString, Plugins::FileSpecs> &remote,
+                        const QHash<QString, Plugins::FileSpecs> &local);
+    void handleRepoFileDownloaded(const QUrl &url,
+                                  const QByteArray &data,
+                                  const QString &filename,
+                                  const QByteArray &hash);
+    void finishRepoDelta(const QString &uid);
+    void handleRepoCatalogDownloaded(const Plugins::RepoSpecs &repo,
+                                     const QByteArray &data);
+    Plugins::RepoPluginSpecs readCatalogPlugin(QCborStreamReader &reader);
+    const QString readCatalogString(QCborStreamReader &reader);
+    double readCatalogNumber(QCborStreamReader &reader);
+    void handlePluginDownloaded(const Plugins::RepoSpecs &repo,
+                                const QUrl &url,
+                                const QByteArray &data,
+                                const QString &filename,
+                                const QByteArray &hash);
+    void reportRefreshFinished();
 
     static bool comparePluginsOrder(const Plugins::PluginSpecs &a,
                                     const Plugins::PluginSpecs &b)
     {
         return a.label < b.label;
     }
+    static bool compareArchiveEntrySize(const Plugins::ArchiveEntrySpecs &a,
+                                        const Plugins::ArchiveEntrySpecs &b)
+    {
+        return a.size > b.size;
+    }
 
 private slots:
 
     void startDownloads();
+    void retryDownloads();
     void handleFileDownloaded(QNetworkReply *reply);
     void handleDownloadError(QNetworkReply::NetworkError error);
     void handleDownloadProgress(qint64 value,
@@ -154,6 +154,13 @@ PluginViewWidget::PluginViewWidget(QWidget *parent,
 
     mainLayout->addWidget(headerWidget);
     mainLayout->addWidget(_pluginDescBrowser);
+
+    if (_plugins) {
+        connect(_plugins->getImageCache(),
+                SIGNAL(imageReady(QUrl)),
+                this,
+                SLOT(handleImageReady(QUrl)));
+    }
 }
 
 void PluginViewWidget::showPlugin(const QString &id)
@@ -189,11 +196,11 @@ void PluginViewWidget::showPlugin(const QString &id)
                                                                                       Qt::KeepAspectRatio,
                                                                                       Qt::SmoothTransformation));
     QString pluginIconPath = QString("%1/%2").arg(plugin.path, plugin.icon);
-    if (!plugin.icon.isEmpty() && QFile::exists(pluginIconPath)) {
-        QPixmap pluginPixmap = QIcon(pluginIconPath).pixmap(_iconSize).scaled(_iconSize,
-                                                                             Qt::KeepAspectRatio,
-                                                                             Qt::SmoothTransformation);
-        if (!pluginPixmap.isNull()) { _pluginIconLabel->setPixmap(pluginPixmap); }
+    bool hasIconFile = !plugin.icon.isEmpty() && QFile::exists(pluginIconPath);
+    _iconUrl = hasIconFile ? QUrl::fromLocalFile(pluginIconPath) : plugin.iconUrl;
+    if (_plugins && !_iconUrl.isEmpty()) { // decoded and scaled in the background
+        handleImageReady(_iconUrl);
+        _plugins->getImageCache()->request(_iconUrl, _iconSize);
     }
 
     QString desc = plugin.desc.replace("\\n", "<br>").replace("\\", "").simplified();
@@ -282,3 +289,10 @@ void PluginViewWidget::handleUpdateButtonReleased()
 {
     emit updatePlugin(_id);
 }
+
+void PluginViewWidget::handleImageReady(const QUrl &url)
+{
+    if (!_plugins || url != _iconUrl) { return; }
+    QPixmap pluginPixmap = _plugins->getImageCache()->getPixmap(url, _iconSize);
+    if (!pluginPixmap.isNull()) { _pluginIconLabel->setPixmap(pluginPixmap); }
+}
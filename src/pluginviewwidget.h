@@ -27,6 +27,7 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QTextBrowser>
+#include <QUrl>
 
 #include "plugins.h"
 
@@ -68,6 +69,7 @@ private:
     QPushButton *_removeButton;
     QPushButton *_updateButton;
     QString _id;
+    QUrl _iconUrl;
 
 private slots:
 
@@ -75,6 +77,7 @@ private slots:
     void handleInstallButtonReleased();
     void handleRemoveButtonReleased();
     void handleUpdateButtonReleased();
+    void handleImageReady(const QUrl &url);
 };
 
 #endif // PLUGINVIEWWIDGET_H
@@ -0,0 +1,154 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+#include "progress.h"
+
+#include <QLocale>
+#include <QMutexLocker>
+#include <QStringList>
+
+Progress::Progress(QObject *parent,
+                   int interval)
+    : QObject(parent)
+    , _interval(interval)
+{
+}
+
+void Progress::start(const QString &id,
+                     const QString &message,
+                     bool isBytes)
+{
+    if (id.isEmpty()) { return; }
+    QString text;
+    qint64 value = 0;
+    qint64 total = 0;
+    {
+        QMutexLocker lock(&_mutex);
+        if (!_elapsed.isValid()) { _elapsed.start(); }
+        TaskSpecs task;
+        task.message = message;
+        task.isBytes = isBytes;
+        _tasks.insert(id, task);
+        _current = id;
+        if (!report(true, text, value, total)) { return; }
+    }
+    emit progress(text, value, total);
+}
+
+void Progress::update(const QString &id,
+                      qint64 value,
+                      qint64 total)
+{
+    QString text;
+    qint64 overallValue = 0;
+    qint64 overallTotal = 0;
+    {
+        QMutexLocker lock(&_mutex);
+        if (!_tasks.contains(id)) { return; }
+        TaskSpecs &task = _tasks[id];
+        task.value = value;
+        task.total = total;
+        _current = id;
+        if (!report(false, text, overallValue, overallTotal)) { return; }
+    }
+    emit progress(text, overallValue, overallTotal);
+}
+
+void Progress::finish(const QString &id)
+{
+    QString text;
+    qint64 value = 0;
+    qint64 total = 0;
+    {
+        QMutexLocker lock(&_mutex);
+        if (!_tasks.contains(id)) { return; }
+        TaskSpecs &task = _tasks[id];
+        task.finished = true;
+        if (task.total > 0) { task.value = task.total; }
+        if (!report(true, text, value, total)) { return; }
+    }
+    emit progress(text, value, total);
+}
+
+bool Progress::isActive()
+{
+    QMutexLocker lock(&_mutex);
+    return !_tasks.isEmpty();
+}
+
+bool Progress::report(bool force,
+                      QString &message,
+                      qint64 &value,
+                      qint64 &total)
+{
+    // _mutex must be held by the caller, emit outside the lock
+    if (!force && _lastUpdate.isValid() && _lastUpdate.elapsed() < _interval) { return false; }
+    _lastUpdate.start();
+
+    int count = _tasks.size();
+    int done = 0;
+    double fraction = 0.0;
+    qint64 bytes = 0;
+    qint64 bytesLeft = 0;
+    bool bytesKnown = true;
+    QHashIterator<QString, TaskSpecs> i(_tasks);
+    while (i.hasNext()) {
+        i.next();
+        const TaskSpecs &task = i.value();
+        if (task.finished) {
+            done++;
+            fraction += 1.0;
+        } else if (task.total > 0) { fraction += double(task.value) / double(task.total); }
+        if (!task.isBytes) { continue; }
+        bytes += task.value;
+        if (task.finished) { continue; }
+        if (task.total > 0) { bytesLeft += task.total - task.value; }
+        else { bytesKnown = false; }
+    }
+
+    message = _tasks.value(_current).message;
+    if (done == count) { // all tasks are done, start over on next task
+        _tasks.clear();
+        _current.clear();
+        _elapsed.invalidate();
+        _lastUpdate.invalidate();
+        value = 1;
+        total = 1;
+        return true;
+    }
+
+    QStringList details;
+    if (count > 1) { details << tr("%1 of %2").arg(done + 1).arg(count); }
+    double seconds = _elapsed.elapsed() / 1000.0;
+    if (bytes > 0 && seconds > 1.0) {
+        double rate = bytes / seconds;
+        QLocale locale;
+        details << tr("%1/s").arg(locale.formattedDataSize(qint64(rate)));
+        if (bytesKnown && bytesLeft > 0) {
+            details << tr("%1 s left").arg(qint64(bytesLeft / rate) + 1);
+        }
+    }
+    if (details.size() > 0) { message.append(QString(" (%1)").arg(details.join(", "))); }
+
+    value = qint64(fraction * 1000 / count);
+    total = 1000;
+    return true;
+}
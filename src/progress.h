@@ -0,0 +1,82 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+
+// minimum time (ms) between progress updates
+#define PROGRESS_UPDATE_INTERVAL 100
+
+class Progress : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit Progress(QObject *parent = nullptr,
+                      int interval = PROGRESS_UPDATE_INTERVAL);
+
+    void start(const QString &id,
+               const QString &message,
+               bool isBytes = true);
+    void update(const QString &id,
+                qint64 value,
+                qint64 total);
+    void finish(const QString &id);
+
+    bool isActive();
+
+signals:
+
+    void progress(const QString &message,
+                  qint64 value,
+                  qint64 total);
+
+private:
+
+    struct TaskSpecs {
+        QString message;
+        qint64 value = 0;
+        qint64 total = 0;
+        bool isBytes = true;
+        bool finished = false;
+    };
+
+    QMutex _mutex;
+    QHash<QString, Progress::TaskSpecs> _tasks;
+    QString _current;
+    QElapsedTimer _elapsed;
+    QElapsedTimer _lastUpdate;
+    int _interval;
+
+    bool report(bool force,
+                QString &message,
+                qint64 &value,
+                qint64 &total);
+};
+
+#endif // PROGRESS_H
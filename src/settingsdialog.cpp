@@ -28,6 +28,7 @@
 #include <QLabel>
 #include <QUrl>
 #include <QFileDialog>
+#include <QStandardItemModel>
 
 SettingsDialog::SettingsDialog(QWidget *parent,
                                Plugins *plugins)
@@ -37,6 +38,12 @@ SettingsDialog::SettingsDialog(QWidget *parent,
     , _applyButton(nullptr)
     , _cancelButton(nullptr)
     , _pluginPath(nullptr)
+    , _extractSelective(nullptr)
+    , _extractGroups(nullptr)
+    , _extractIncremental(nullptr)
+    , _archiveStorage(nullptr)
+    , _objectStore(nullptr)
+    , _installMode(nullptr)
 {
     if (!_plugins) { reject(); }
 
@@ -103,7 +110,67 @@ void SettingsDialog::setupGeneral()
     pluginPathEditLayout->addWidget(_pluginPath);
     pluginPathEditLayout->addWidget(pluginPathEditButton);
 
+    _extractSelective = new QCheckBox(tr("Only extract plug-ins from repositories"), this);
+    _extractSelective->setChecked(_plugins->getExtractSelective());
+
+    const auto extractGroupsEditWidget = new QWidget(this);
+    const auto extractGroupsEditLayout = new QHBoxLayout(extractGroupsEditWidget);
+
+    const auto extractGroupsEditLabel = new QLabel(tr("Only extract groups"), this);
+    _extractGroups = new QLineEdit(this);
+    _extractGroups->setProperty("StyleEdit", true);
+    _extractGroups->setPlaceholderText(tr("All groups"));
+    _extractGroups->setToolTip(tr("Comma separated list of groups, applies to new downloads."));
+    _extractGroups->setText(_plugins->getExtractGroups().join(", "));
+    _extractGroups->setEnabled(_extractSelective->isChecked());
+    connect(_extractSelective,
+            SIGNAL(toggled(bool)),
+            _extractGroups,
+            SLOT(setEnabled(bool)));
+
+    _extractIncremental = new QCheckBox(tr("Only extract changed files"), this);
+    _extractIncremental->setToolTip(tr("Unchanged files are linked from the current copy instead of written again."));
+    _extractIncremental->setChecked(_plugins->getExtractIncremental());
+
+    _archiveStorage = new QCheckBox(tr("Keep repositories as archives"), this);
+    _archiveStorage->setToolTip(tr("Uses less disk space, plug-ins are extracted when installed."));
+    _archiveStorage->setChecked(_plugins->getArchiveStorage());
+
+    _objectStore = new QCheckBox(tr("Share identical files"), this);
+    _objectStore->setToolTip(tr("Identical files in repositories are stored once, installed plug-ins share their data where the filesystem supports it and stay writable."));
+    _objectStore->setChecked(_plugins->getObjectStore());
+    _objectStore->setEnabled(ObjectStore::isSupported());
+
+    const auto installModeEditWidget = new QWidget(this);
+    const auto installModeEditLayout = new QHBoxLayout(installModeEditWidget);
+
+    const auto installModeEditLabel = new QLabel(tr("Install plug-ins as"), this);
+    _installMode = new QComboBox(this);
+    _installMode->addItem(tr("Copies"), PLUGINS_INSTALL_MODE_COPY);
+    _installMode->addItem(tr("Linked folders (tracks repository)"), PLUGINS_INSTALL_MODE_SYMLINK);
+    _installMode->setToolTip(tr("Copies share their data with the repository cache where the filesystem supports it. Linked folders use no extra disk space and always match the repository, they are never listed as updates. Falls back to copies when linking is not possible."));
+    _installMode->setCurrentIndex(_installMode->findData(_plugins->getInstallMode()));
+    handleArchiveStorage(_archiveStorage->isChecked());
+    connect(_archiveStorage,
+            SIGNAL(toggled(bool)),
+            this,
+            SLOT(handleArchiveStorage(bool)));
+
+    installModeEditLayout->addWidget(installModeEditLabel);
+    installModeEditLayout->addStretch();
+    installModeEditLayout->addWidget(_installMode);
+
+    extractGroupsEditLayout->addWidget(extractGroupsEditLabel);
+    extractGroupsEditLayout->addStretch();
+    extractGroupsEditLayout->addWidget(_extractGroups);
+
     generalLayout->addWidget(pluginPathEditWidget);
+    generalLayout->addWidget(_extractSelective);
+    generalLayout->addWidget(extractGroupsEditWidget);
+    generalLayout->addWidget(_extractIncremental);
+    generalLayout->addWidget(_archiveStorage);
+    generalLayout->addWidget(_objectStore);
+    generalLayout->addWidget(installModeEditWidget);
     generalLayout->addStretch();
 }
 
@@ -118,6 +185,38 @@ void SettingsDialog::handleApplyButton()
         changed = true;
     }
 
+    if (_extractSelective->isChecked() != _plugins->getExtractSelective()) {
+        _plugins->setExtractSelective(_extractSelective->isChecked());
+        changed = true;
+    }
+
+    if (_archiveStorage->isChecked() != _plugins->getArchiveStorage()) {
+        _plugins->setArchiveStorage(_archiveStorage->isChecked());
+        changed = true;
+    }
+
+    if (_extractIncremental->isChecked() != _plugins->getExtractIncremental()) {
+        _plugins->setExtractIncremental(_extractIncremental->isChecked());
+    }
+
+    int installMode = _installMode->currentData().toInt();
+    if (installMode != _plugins->getInstallMode()) { _plugins->setInstallMode(installMode); }
+
+    if (_objectStore->isChecked() != _plugins->getObjectStore()) {
+        _plugins->setObjectStore(_objectStore->isChecked()); // used from the next extract/install
+    }
+
+    QStringList groups;
+    QStringList groupsText = _extractGroups->text().split(",");
+    for (int i = 0; i < groupsText.size(); ++i) {
+        QString group = groupsText.at(i).trimmed();
+        if (!group.isEmpty()) { groups << group; }
+    }
+    if (groups != _plugins->getExtractGroups()) {
+        _plugins->setExtractGroups(groups);
+        changed = true;
+    }
+
     if (changed) { accept(); }
     else { reject(); }
 }
@@ -130,3 +229,14 @@ void SettingsDialog::handleSelectButton()
                                                     QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
     if (!dir.isEmpty()) { _pluginPath->setText(dir); }
 }
+
+void SettingsDialog::handleArchiveStorage(bool enabled)
+{
+    // linked folders point into the extracted repository, there is none in archive storage
+    int index = _installMode->findData(PLUGINS_INSTALL_MODE_SYMLINK);
+    QStandardItemModel *model = qobject_cast<QStandardItemModel*>(_installMode->model());
+    if (model && index > -1) { model->item(index)->setEnabled(!enabled); }
+    if (enabled && _installMode->currentIndex() == index) {
+        _installMode->setCurrentIndex(_installMode->findData(PLUGINS_INSTALL_MODE_COPY));
+    }
+}
@@ -26,6 +26,8 @@
 #include <QPushButton>
 #include <QLineEdit>
 #include <QTabWidget>
+#include <QCheckBox>
+#include <QComboBox>
 
 #include "plugins.h"
 
@@ -47,6 +49,12 @@ private:
     QPushButton *_cancelButton;
 
     QLineEdit *_pluginPath;
+    QCheckBox *_extractSelective;
+    QLineEdit *_extractGroups;
+    QCheckBox *_extractIncremental;
+    QCheckBox *_archiveStorage;
+    QCheckBox *_objectStore;
+    QComboBox *_installMode;
 
     void setupGeneral();
 
@@ -54,6 +62,7 @@ private slots:
 
     void handleApplyButton();
     void handleSelectButton();
+    void handleArchiveStorage(bool enabled);
 };
 
 #endif // SETTINGSDIALOG_H
@@ -0,0 +1,241 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+
+#include "trash.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QFileInfoList>
+#include <QDir>
+#include <QSettings>
+#include <QThread>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QtConcurrentRun>
+
+Trash::Trash(const QString &path,
+             QObject *parent)
+    : QObject(parent)
+    , _path(path)
+    , _timer(nullptr)
+{
+    _pool.setMaxThreadCount(1); // one reaper at a time
+
+    _timer = new QTimer(this);
+    _timer->setSingleShot(true);
+    _timer->setInterval(TRASH_REAP_DELAY);
+    connect(_timer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(reapInBackground()));
+}
+
+const QString Trash::getPath()
+{
+    return _path;
+}
+
+bool Trash::move(const QString &path,
+                 const QString &id)
+{
+    QFileInfo source(path);
+    if (_path.isEmpty() || (!source.exists() && !source.isSymLink())) { return false; }
+    {
+        QMutexLocker lock(&_mutex);
+        if (take(path, id, nullptr).isEmpty()) { return false; }
+    }
+
+    // restarted on each move, the last one can always be undone for a while
+    QMetaObject::invokeMethod(_timer, "start", Qt::QueuedConnection);
+    return true;
+}
+
+bool Trash::discard(const QString &path)
+{
+    QFileInfo source(path);
+    if (!source.exists() && !source.isSymLink()) { return false; }
+
+    // nothing to undo, out of the way now and removed right after
+    QString info;
+    QString location;
+    if (!_path.isEmpty()) {
+        QMutexLocker lock(&_mutex);
+        location = take(path, QString(), &info);
+    }
+    if (location.isEmpty()) { location = path; } // can't be moved, remove in place
+    QFuture<void> f = QtConcurrent::run(&_pool, [location, info]() {
+        QThread::currentThread()->setPriority(QThread::IdlePriority);
+        removeTree(location);
+        if (!info.isEmpty()) { QFile::remove(info); }
+    });
+    Q_UNUSED(f)
+    return true;
+}
+
+const QString Trash::restore(const QString &id)
+{
+    if (id.isEmpty()) { return QString(); } // discarded, not restorable
+    QMutexLocker lock(&_mutex);
+    QStringList infos = getInfoFiles(id);
+    for (int i = 0; i < infos.size(); ++i) { // newest first
+        QString path;
+        QString location;
+        {
+            QSettings settings(infos.at(i), QSettings::IniFormat);
+            path = settings.value(TRASH_KEY_PATH).toString();
+            location = settings.value(TRASH_KEY_LOCATION).toString();
+        }
+        QFileInfo trashed(location);
+        if (path.isEmpty() || (!trashed.exists() && !trashed.isSymLink())) { continue; }
+        QFileInfo current(path);
+        if (current.exists() || current.isSymLink()) { return QString(); } // don't replace what is there now
+        QDir dir;
+        dir.mkpath(current.absolutePath());
+        if (!QFile::rename(location, path)) { return QString(); }
+        QFile::remove(infos.at(i));
+        return path;
+    }
+    return QString();
+}
+
+bool Trash::has(const QString &id)
+{
+    if (id.isEmpty()) { return false; }
+    QMutexLocker lock(&_mutex);
+    return getInfoFiles(id).size() > 0;
+}
+
+int Trash::reap()
+{
+    QStringList trees;
+    {
+        // claim everything, a folder can't be restored once its info is gone
+        QMutexLocker lock(&_mutex);
+        if (_path.isEmpty() || !QFile::exists(_path)) { return 0; }
+        QStringList infos = getInfoFiles();
+        for (int i = 0; i < infos.size(); ++i) {
+            {
+                QSettings settings(infos.at(i), QSettings::IniFormat);
+                QString location = settings.value(TRASH_KEY_LOCATION).toString();
+                if (!location.isEmpty()) { trees << location; }
+            }
+            QFile::remove(infos.at(i));
+        }
+
+        // leftovers if we crashed while moving or reaping
+        QDir dir(_path);
+        QStringList entries = dir.entryList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+        for (int i = 0; i < entries.size(); ++i) {
+            QString tree = QString("%1/%2").arg(_path, entries.at(i));
+            if (!trees.contains(tree)) { trees << tree; }
+        }
+    }
+
+    int removed = 0;
+    for (int i = 0; i < trees.size(); ++i) {
+        QFileInfo tree(trees.at(i));
+        if (!tree.exists() && !tree.isSymLink()) { continue; }
+        removeTree(trees.at(i));
+        removed++;
+    }
+    emit reaped();
+    return removed;
+}
+
+void Trash::reapInBackground()
+{
+    QFuture<void> f = QtConcurrent::run(&_pool, [this]() {
+        // don't compete with the ui or running installs
+        QThread::currentThread()->setPriority(QThread::IdlePriority);
+        reap();
+    });
+    Q_UNUSED(f)
+}
+
+const QString Trash::take(const QString &path,
+                          const QString &id,
+                          QString *info)
+{
+    // the caller holds the lock
+    QFileInfo source(path);
+    QDir dir;
+    dir.mkpath(_path);
+    QString uid = QString::number(QRandomGenerator::global()->generate64());
+    QString infoPath = getInfoPath(uid);
+    QString location = QString("%1/%2").arg(_path, uid);
+
+    // the info is written first, a folder without one is reaped as a leftover
+    {
+        QSettings settings(infoPath, QSettings::IniFormat);
+        settings.setValue(TRASH_KEY_ID, id);
+        settings.setValue(TRASH_KEY_PATH, source.absoluteFilePath());
+        settings.setValue(TRASH_KEY_LOCATION, location);
+        settings.sync();
+    }
+    if (!QFile::rename(path, location)) { // other filesystem, keep it hidden next to where it was
+        location = QString("%1/.%2%3").arg(source.absolutePath(), uid, TRASH_SIBLING_SUFFIX);
+        if (!QFile::rename(path, location)) {
+            QFile::remove(infoPath);
+            return QString();
+        }
+        QSettings settings(infoPath, QSettings::IniFormat);
+        settings.setValue(TRASH_KEY_LOCATION, location);
+        settings.sync();
+    }
+    if (info) { *info = infoPath; }
+    return location;
+}
+
+const QString Trash::getInfoPath(const QString &uid)
+{
+    return QString("%1/%2%3").arg(_path, uid, TRASH_INFO_SUFFIX);
+}
+
+const QStringList Trash::getInfoFiles(const QString &id)
+{
+    QStringList result;
+    if (_path.isEmpty() || !QFile::exists(_path)) { return result; }
+    QDir dir(_path);
+    QFileInfoList infos = dir.entryInfoList(QStringList() << QString("*%1").arg(TRASH_INFO_SUFFIX),
+                                            QDir::Files | QDir::NoDotAndDotDot,
+                                            QDir::Time); // newest first
+    for (int i = 0; i < infos.size(); ++i) {
+        QString info = infos.at(i).filePath();
+        if (!id.isEmpty()) {
+            QSettings settings(info, QSettings::IniFormat);
+            if (settings.value(TRASH_KEY_ID).toString() != id) { continue; }
+        }
+        result << info;
+    }
+    return result;
+}
+
+void Trash::removeTree(const QString &path)
+{
+    QFileInfo info(path);
+    if (info.isSymLink() || !info.isDir()) { // linked install, never follow
+        QFile::remove(path);
+        return;
+    }
+    QDir dir(path);
+    dir.removeRecursively();
+}
@@ -0,0 +1,87 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+
+#ifndef TRASH_H
+#define TRASH_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+#include <QTimer>
+#include <QThreadPool>
+
+// delay (ms) before trashed folders are deleted, until then they can be restored
+#define TRASH_REAP_DELAY 120000
+
+// suffix of the info file stored next to each trashed folder
+#define TRASH_INFO_SUFFIX ".info"
+
+// keys in the info file
+#define TRASH_KEY_ID "Id"
+#define TRASH_KEY_PATH "Path"
+#define TRASH_KEY_LOCATION "Location"
+
+// suffix used when a folder can't be moved into the trash (other filesystem)
+#define TRASH_SIBLING_SUFFIX ".trash"
+
+class Trash : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit Trash(const QString &path,
+                   QObject *parent = nullptr);
+
+    const QString getPath();
+    bool move(const QString &path,
+              const QString &id = QString());
+    bool discard(const QString &path);
+    const QString restore(const QString &id);
+    bool has(const QString &id);
+    int reap();
+
+signals:
+
+    void reaped();
+
+public slots:
+
+    void reapInBackground();
+
+private:
+
+    QString _path;
+    QMutex _mutex;
+    QTimer *_timer;
+    QThreadPool _pool;
+
+    const QString take(const QString &path,
+                       const QString &id,
+                       QString *info);
+    const QString getInfoPath(const QString &uid);
+    const QStringList getInfoFiles(const QString &id = QString());
+    static void removeTree(const QString &path);
+};
+
+#endif // TRASH_H
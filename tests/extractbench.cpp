@@ -0,0 +1,185 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+// Extraction time of the original sequential 2048 byte loop against
+// Plugins::extractPluginArchive, for many small and a few large files.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QDirIterator>
+#include <QFile>
+#include <QDir>
+#include <QLocale>
+#include <QThreadPool>
+
+#include <zip.h>
+
+#include "plugins.h"
+#include "repogen.h"
+
+// chunk size of the original extraction loop
+#define EXTRACTBENCH_BASELINE_BUF_SIZE 2048
+
+static bool extractBaseline(const QString &filename,
+                            const QString &folder)
+{
+    // as extractPluginArchive was before it was optimized
+    int error;
+    struct zip* p_zip = zip_open(filename.toUtf8().constData(), 0, &error);
+    if (p_zip == NULL) { return false; }
+    bool success = true;
+    char buffer[EXTRACTBENCH_BASELINE_BUF_SIZE];
+    zip_int64_t n_entries = zip_get_num_entries(p_zip, 0);
+    for (zip_int64_t entry_idx = 0; entry_idx < n_entries && success; entry_idx++) {
+        struct zip_stat file_stat;
+        if (zip_stat_index(p_zip, entry_idx, 0, &file_stat)) {
+            success = false;
+            break;
+        }
+        if (!(file_stat.valid & ZIP_STAT_NAME) || file_stat.name[0] == '\0') { continue; }
+        QString name = QString::fromUtf8(file_stat.name);
+        QString filePath = QString("%1/%2").arg(folder, name);
+        if (name.endsWith("/")) {
+            QDir newDir;
+            success = newDir.mkpath(filePath);
+            continue;
+        }
+        struct zip_file* p_file = zip_fopen_index(p_zip, entry_idx, 0);
+        if (p_file == NULL) {
+            success = false;
+            break;
+        }
+        QFile output(filePath);
+        if (!output.open(QIODevice::WriteOnly)) {
+            zip_fclose(p_file);
+            success = false;
+            break;
+        }
+        zip_int64_t bytes_read;
+        while ((bytes_read = zip_fread(p_file, buffer, EXTRACTBENCH_BASELINE_BUF_SIZE)) > 0) {
+            if (output.write(buffer, bytes_read) != bytes_read) {
+                success = false;
+                break;
+            }
+        }
+        if (bytes_read < 0) { success = false; }
+        output.close();
+        zip_fclose(p_file);
+    }
+    zip_close(p_zip);
+    return success;
+}
+
+static int countFiles(const QString &folder)
+{
+    int files = 0;
+    QDirIterator it(folder, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        files++;
+    }
+    return files;
+}
+
+static bool runScenario(Plugins *plugins,
+                        const QString &label,
+                        const QString &path,
+                        int pluginCount,
+                        int files,
+                        int size,
+                        int runs,
+                        QTextStream &out)
+{
+    QString filename = QString("%1/%2.zip").arg(path, label);
+    QFile archive(filename);
+    if (!archive.open(QIODevice::WriteOnly)) { return false; }
+    QByteArray data = RepoGenerator::createArchive(RepoGenerator::getRepoFiles(pluginCount, files, size));
+    bool written = !data.isEmpty() && archive.write(data) == data.size();
+    archive.close();
+    if (!written) { return false; }
+    int expected = pluginCount * (files + 1) + 1;
+
+    // best of each, the first run also warms the page cache
+    qint64 baseline = -1;
+    qint64 current = -1;
+    for (int run = 0; run < runs; ++run) {
+        for (int mode = 0; mode < 2; ++mode) {
+            QString folder = QString("%1/%2-%3-%4").arg(path, label).arg(mode).arg(run);
+            QDir dir;
+            if (!dir.mkpath(folder)) { return false; }
+            QElapsedTimer timer;
+            timer.start();
+            bool success = mode == 0 ? extractBaseline(filename, folder) : plugins->extractPluginArchive(filename, folder).success;
+            qint64 elapsed = timer.elapsed();
+            if (!success || countFiles(folder) != expected) {
+                out << label << ": " << (mode == 0 ? "baseline" : "current") << " extraction failed" << Qt::endl;
+                return false;
+            }
+            qint64 &best = mode == 0 ? baseline : current;
+            if (best < 0 || elapsed < best) { best = elapsed; }
+            QDir(folder).removeRecursively();
+        }
+    }
+    QFile::remove(filename);
+
+    out << label << ": " << expected << " files, archive " << QLocale().formattedDataSize(data.size())
+        << ", baseline " << baseline << " ms, current " << current << " ms";
+    if (current > 0) { out << ", " << QString::number(double(baseline) / double(current), 'f', 2) << "x"; }
+    out << Qt::endl;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    // never touch the real cache or settings
+    QTemporaryDir home;
+    if (!home.isValid()) { return 1; }
+    qputenv("HOME", home.path().toUtf8());
+    qunsetenv("XDG_CACHE_HOME");
+    qunsetenv("XDG_CONFIG_HOME");
+    qunsetenv("XDG_DATA_HOME");
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ExtractBenchmark");
+    QCoreApplication::setOrganizationName(APP_ORG);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Archive extraction benchmark");
+    parser.addHelpOption();
+    QCommandLineOption scaleOption("scale", "Multiply the number of plug-ins.", "factor", "1");
+    QCommandLineOption runsOption("runs", "Extractions of each kind, the best one is reported.", "count", "3");
+    parser.addOptions(QList<QCommandLineOption>() << scaleOption << runsOption);
+    parser.process(app);
+
+    int scale = parser.value(scaleOption).toInt();
+    int runs = parser.value(runsOption).toInt();
+    if (scale < 1 || runs < 1) { return 1; }
+
+    QTextStream out(stdout);
+    Plugins plugins;
+    bool success = runScenario(&plugins, "small", home.path(), 200 * scale, 20, 2048, runs, out) &&
+                   runScenario(&plugins, "large", home.path(), 2 * scale, 4, 8388608, runs, out);
+    QThreadPool::globalInstance()->waitForDone();
+    return success ? 0 : 1;
+}
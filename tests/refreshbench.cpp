@@ -0,0 +1,175 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+// Time to catalog for a generated repository served over a local HTTP stub,
+// with optional latency, bandwidth limit, errors and 304 responses.
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QEventLoop>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QLocale>
+#include <QThreadPool>
+
+#include "plugins.h"
+#include "stubserver.h"
+#include "repogen.h"
+
+// time (ms) to wait for the stub server to finish after the catalog is ready
+#define REFRESHBENCH_SETTLE_TIMEOUT 5000
+
+static bool waitForRefresh(Plugins *plugins,
+                           int timeout,
+                           qint64 *elapsed,
+                           qint64 *peakMemory)
+{
+    bool finished = false;
+    QEventLoop loop;
+    QObject::connect(plugins, &Plugins::refreshFinished, &loop, [&](qint64 ms, qint64 memory) {
+        finished = true;
+        *elapsed = ms;
+        *peakMemory = memory;
+        loop.quit();
+    });
+    QTimer::singleShot(timeout, &loop, SLOT(quit()));
+    plugins->loadRepositories();
+    if (!finished) { loop.exec(); }
+    return finished;
+}
+
+static void waitForServer(StubServer *server)
+{
+    // the logo is revalidated in the background, count those requests too
+    QElapsedTimer timer;
+    timer.start();
+    while (!server->isIdle() && timer.elapsed() < REFRESHBENCH_SETTLE_TIMEOUT) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // never touch the real cache, settings or plug-ins
+    QTemporaryDir home;
+    if (!home.isValid()) { return 1; }
+    qputenv("HOME", home.path().toUtf8());
+    qunsetenv("XDG_CACHE_HOME");
+    qunsetenv("XDG_CONFIG_HOME");
+    qunsetenv("XDG_DATA_HOME");
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) { qputenv("QT_QPA_PLATFORM", "offscreen"); }
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("RefreshBenchmark");
+    QCoreApplication::setOrganizationName(APP_ORG);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Repository refresh benchmark");
+    parser.addHelpOption();
+    QCommandLineOption pluginsOption("plugins", "Plug-ins in the repository.", "count", "100");
+    QCommandLineOption filesOption("files", "Extra files per plug-in.", "count", "4");
+    QCommandLineOption sizeOption("size", "Size of each extra file.", "bytes", "4096");
+    QCommandLineOption latencyOption("latency", "Delay before each response.", "ms", "0");
+    QCommandLineOption bandwidthOption("bandwidth", "Bandwidth per connection, 0 is unlimited.", "bytes/s", "0");
+    QCommandLineOption failuresOption("failures", "Answer the first requests with an error.", "count", "0");
+    QCommandLineOption notModifiedOption("not-modified", "Answer conditional requests with 304, even if changed.", "count", "0");
+    QCommandLineOption runsOption("runs", "Sessions to run, the first one is cold.", "count", "1");
+    QCommandLineOption timeoutOption("timeout", "Give up a session after.", "ms", "120000");
+    parser.addOptions(QList<QCommandLineOption>() << pluginsOption << filesOption << sizeOption
+                                                  << latencyOption << bandwidthOption << failuresOption
+                                                  << notModifiedOption << runsOption << timeoutOption);
+    parser.process(app);
+
+    int pluginCount = parser.value(pluginsOption).toInt();
+    int runs = parser.value(runsOption).toInt();
+    int timeout = parser.value(timeoutOption).toInt();
+
+    QTextStream out(stdout);
+    QByteArray archive = RepoGenerator::createArchive(RepoGenerator::getRepoFiles(pluginCount,
+                                                                                  parser.value(filesOption).toInt(),
+                                                                                  parser.value(sizeOption).toInt()));
+    if (archive.isEmpty()) {
+        out << "failed to create the repository archive" << Qt::endl;
+        return 1;
+    }
+
+    StubServer server;
+    if (!server.start()) {
+        out << "failed to start the server: " << server.errorString() << Qt::endl;
+        return 1;
+    }
+    server.setLatency(parser.value(latencyOption).toInt());
+    server.setBandwidth(parser.value(bandwidthOption).toLongLong());
+    server.setFailures(parser.value(failuresOption).toInt());
+    server.setNotModified(parser.value(notModifiedOption).toInt());
+    QByteArray manifest = RepoGenerator::createManifest("Benchmark",
+                                                        server.getUrl("/manifest.xml"),
+                                                        server.getUrl("/repo.zip"),
+                                                        server.getUrl("/logo.png"));
+    server.addFile("/manifest.xml", manifest, "application/xml");
+    server.addFile("/repo.zip", archive, "application/zip");
+    server.addFile("/logo.png", RepoGenerator::createLogo(), "image/png");
+
+    out << pluginCount << " plug-ins, archive " << QLocale().formattedDataSize(archive.size())
+        << ", latency " << parser.value(latencyOption) << " ms"
+        << ", bandwidth " << parser.value(bandwidthOption) << " bytes/s"
+        << ", " << parser.value(failuresOption) << " errors"
+        << ", " << parser.value(notModifiedOption) << " forced 304" << Qt::endl;
+
+    bool success = true;
+    for (int run = 0; run < runs && success; ++run) {
+        int requests = server.getRequests();
+        int failures = server.getFailures();
+        int notModified = server.getNotModified();
+
+        Plugins *plugins = new Plugins();
+        if (run == 0) {
+            if (!plugins->addRepository(QString::fromUtf8(manifest))) {
+                out << "failed to add the repository" << Qt::endl;
+                delete plugins;
+                return 1;
+            }
+            plugins->saveRepositories(plugins->getAvailableRepositories());
+        }
+
+        qint64 elapsed = 0;
+        qint64 peakMemory = 0;
+        bool finished = waitForRefresh(plugins, timeout, &elapsed, &peakMemory);
+        int available = int(plugins->getAvailablePlugins().size());
+        waitForServer(&server);
+        QThreadPool::globalInstance()->waitForDone(); // background cleanup uses the plug-ins
+        delete plugins;
+
+        out << "run " << run + 1 << ": ";
+        if (finished) { out << elapsed << " ms to catalog"; }
+        else { out << "timed out after " << timeout << " ms"; }
+        out << ", " << available << " of " << pluginCount << " plug-ins"
+            << ", peak RSS " << (peakMemory > 0 ? QLocale().formattedDataSize(peakMemory) : QString("unknown"))
+            << ", " << server.getRequests() - requests << " requests"
+            << ", " << server.getFailures() - failures << " errors"
+            << ", " << server.getNotModified() - notModified << " not modified" << Qt::endl;
+        success = finished && available == pluginCount;
+    }
+
+    return success ? 0 : 1;
+}
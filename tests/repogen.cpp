@@ -0,0 +1,176 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+#include "repogen.h"
+
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QImage>
+#include <QBuffer>
+#include <QColor>
+
+#include <vector>
+
+#include <zip.h>
+
+const QByteArray RepoGenerator::getPluginPy(const QString &folder)
+{
+    // only what Plugins::parsePluginPy reads
+    QString py;
+    py.append("def getPluginID():\n");
+    py.append(QString("    return \"org.natronvfx.benchmark.%1\"\n\n").arg(folder));
+    py.append("def getLabel():\n");
+    py.append(QString("    return \"%1\"\n\n").arg(folder));
+    py.append("def getVersion():\n");
+    py.append("    return 1\n\n");
+    py.append("def getGrouping():\n");
+    py.append(QString("    return \"Community/%1\"\n\n").arg(REPOGEN_GROUP));
+    py.append("def getPluginDescription():\n");
+    py.append("    return \"Generated for benchmarks.\"\n");
+    return py.toUtf8();
+}
+
+const QByteArray RepoGenerator::getData(int size,
+                                        quint32 seed)
+{
+    // random, so the archive is about as large as the files
+    QByteArray data(size, Qt::Uninitialized);
+    QRandomGenerator random(seed);
+    for (int i = 0; i < size; ++i) { data[i] = char(random.bounded(256)); }
+    return data;
+}
+
+const QMap<QString, QByteArray> RepoGenerator::getRepoFiles(int plugins,
+                                                            int files,
+                                                            int size)
+{
+    QMap<QString, QByteArray> result;
+    for (int i = 0; i < plugins; ++i) {
+        QString folder = QString("Benchmark%1").arg(i);
+        result.insert(QString("%1/%1.py").arg(folder), getPluginPy(folder));
+        for (int j = 0; j < files; ++j) {
+            result.insert(QString("%1/data/%2.bin").arg(folder).arg(j), getData(size, quint32(i * files + j)));
+        }
+    }
+    result.insert("README.md", "Generated for benchmarks, not a plug-in.\n");
+    return result;
+}
+
+const QByteArray RepoGenerator::createArchive(const QMap<QString, QByteArray> &files)
+{
+    QByteArray result;
+    zip_error_t error;
+    zip_error_init(&error);
+    zip_source_t *source = zip_source_buffer_create(NULL, 0, 0, &error);
+    if (source == NULL) { return result; }
+    zip_source_keep(source); // still needed after zip_close
+    zip_t *p_zip = zip_open_from_source(source, ZIP_TRUNCATE, &error);
+    if (p_zip == NULL) {
+        zip_source_free(source);
+        zip_error_fini(&error);
+        return result;
+    }
+
+    // every folder gets an entry, like most zip tools do
+    QStringList dirs;
+    QMapIterator<QString, QByteArray> it(files);
+    while (it.hasNext()) {
+        it.next();
+        QStringList parts = it.key().split("/");
+        parts.removeLast();
+        QString dir;
+        for (int i = 0; i < parts.size(); ++i) {
+            dir.append(QString("%1/").arg(parts.at(i)));
+            if (!dirs.contains(dir)) { dirs << dir; }
+        }
+    }
+    for (int i = 0; i < dirs.size(); ++i) { zip_dir_add(p_zip, dirs.at(i).toUtf8().constData(), ZIP_FL_ENC_UTF_8); }
+
+    // libzip reads the buffers on zip_close
+    std::vector<QByteArray> buffers;
+    buffers.reserve(files.size());
+    it.toFront();
+    while (it.hasNext()) {
+        it.next();
+        buffers.push_back(it.value());
+        zip_source_t *file = zip_source_buffer(p_zip, buffers.back().constData(), zip_uint64_t(buffers.back().size()), 0);
+        if (file == NULL ||
+            zip_file_add(p_zip, it.key().toUtf8().constData(), file, ZIP_FL_ENC_UTF_8 | ZIP_FL_OVERWRITE) < 0)
+        {
+            if (file) { zip_source_free(file); }
+            zip_discard(p_zip);
+            zip_source_free(source);
+            zip_error_fini(&error);
+            return result;
+        }
+    }
+    if (zip_close(p_zip) < 0) {
+        zip_discard(p_zip);
+        zip_source_free(source);
+        zip_error_fini(&error);
+        return result;
+    }
+
+    if (zip_source_open(source) == 0) {
+        zip_source_seek(source, 0, SEEK_END);
+        zip_int64_t size = zip_source_tell(source);
+        zip_source_seek(source, 0, SEEK_SET);
+        if (size > 0) {
+            result.resize(int(size));
+            if (zip_source_read(source, result.data(), zip_uint64_t(size)) != size) { result.clear(); }
+        }
+        zip_source_close(source);
+    }
+    zip_source_free(source);
+    zip_error_fini(&error);
+    return result;
+}
+
+const QByteArray RepoGenerator::createManifest(const QString &title,
+                                               const QUrl &manifest,
+                                               const QUrl &zip,
+                                               const QUrl &logo)
+{
+    QString xml;
+    xml.append("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n");
+    xml.append("<repo>\n");
+    xml.append("    <version>1.0</version>\n");
+    xml.append(QString("    <title>%1</title>\n").arg(title.toHtmlEscaped()));
+    xml.append(QString("    <manifest>%1</manifest>\n").arg(manifest.toString()));
+    if (!logo.isEmpty()) { xml.append(QString("    <logo>%1</logo>\n").arg(logo.toString())); }
+    xml.append(QString("    <zip>%1</zip>\n").arg(zip.toString()));
+    xml.append("    <modified>2021-11-25 19:00</modified>\n");
+    xml.append("</repo>\n");
+    return xml.toUtf8();
+}
+
+const QByteArray RepoGenerator::createLogo()
+{
+    QByteArray data;
+    QImage image(128, 128, QImage::Format_ARGB32);
+    image.fill(QColor(Qt::darkGray));
+    QBuffer buffer(&data);
+    if (buffer.open(QIODevice::WriteOnly)) {
+        image.save(&buffer, "PNG");
+        buffer.close();
+    }
+    return data;
+}
@@ -0,0 +1,51 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+#ifndef REPOGEN_H
+#define REPOGEN_H
+
+#include <QString>
+#include <QByteArray>
+#include <QMap>
+#include <QUrl>
+
+// group of the generated plug-ins
+#define REPOGEN_GROUP "Benchmark"
+
+class RepoGenerator
+{
+public:
+
+    static const QByteArray getPluginPy(const QString &folder);
+    static const QByteArray getData(int size,
+                                    quint32 seed);
+    static const QMap<QString, QByteArray> getRepoFiles(int plugins,
+                                                        int files,
+                                                        int size);
+    static const QByteArray createArchive(const QMap<QString, QByteArray> &files);
+    static const QByteArray createManifest(const QString &title,
+                                           const QUrl &manifest,
+                                           const QUrl &zip,
+                                           const QUrl &logo);
+    static const QByteArray createLogo();
+};
+
+#endif // REPOGEN_H
@@ -0,0 +1,233 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+#include "stubserver.h"
+
+#include <QHostAddress>
+#include <QCryptographicHash>
+#include <QList>
+
+StubServer::StubServer(QObject *parent)
+    : QTcpServer(parent)
+    , _pacer(nullptr)
+    , _latency(0)
+    , _bandwidth(0)
+    , _failures(0)
+    , _notModified(0)
+    , _connections(0)
+    , _requestCount(0)
+    , _failureCount(0)
+    , _notModifiedCount(0)
+{
+    _pacer = new QTimer(this);
+    _pacer->setInterval(STUBSERVER_PACE_INTERVAL);
+    connect(_pacer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(handlePace()));
+    connect(this,
+            SIGNAL(newConnection()),
+            this,
+            SLOT(handleNewConnection()));
+}
+
+bool StubServer::start()
+{
+    return listen(QHostAddress::LocalHost);
+}
+
+void StubServer::addFile(const QString &path,
+                         const QByteArray &data,
+                         const QByteArray &type)
+{
+    FileSpecs file;
+    file.data = data;
+    file.type = type;
+    file.etag = QString("\"%1\"").arg(QString::fromUtf8(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex())).toUtf8();
+    _files.insert(path, file);
+}
+
+const QUrl StubServer::getUrl(const QString &path)
+{
+    return QUrl(QString("http://127.0.0.1:%1%2").arg(serverPort()).arg(path));
+}
+
+void StubServer::setLatency(int ms)
+{
+    _latency = ms;
+}
+
+void StubServer::setBandwidth(qint64 bytesPerSecond)
+{
+    _bandwidth = bytesPerSecond;
+}
+
+void StubServer::setFailures(int count)
+{
+    _failures = count;
+}
+
+void StubServer::setNotModified(int count)
+{
+    _notModified = count;
+}
+
+int StubServer::getRequests()
+{
+    return _requestCount;
+}
+
+int StubServer::getFailures()
+{
+    return _failureCount;
+}
+
+int StubServer::getNotModified()
+{
+    return _notModifiedCount;
+}
+
+bool StubServer::isIdle()
+{
+    return _connections < 1 && !hasPendingConnections();
+}
+
+void StubServer::handleNewConnection()
+{
+    while (hasPendingConnections()) {
+        QTcpSocket *socket = nextPendingConnection();
+        _connections++;
+        _requests.insert(socket, QByteArray());
+        connect(socket,
+                SIGNAL(readyRead()),
+                this,
+                SLOT(handleReadyRead()));
+        connect(socket,
+                SIGNAL(disconnected()),
+                this,
+                SLOT(handleDisconnected()));
+    }
+}
+
+void StubServer::handleReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(QObject::sender());
+    if (!socket || !_requests.contains(socket)) { return; }
+    QByteArray &request = _requests[socket];
+    request.append(socket->readAll());
+    if (!request.contains("\r\n\r\n")) { return; } // only GET, no body
+
+    QByteArray response = getResponse(_requests.take(socket));
+    QPointer<QTcpSocket> pending(socket);
+    if (_latency > 0) {
+        QTimer::singleShot(_latency, this, [this, pending, response]() { sendResponse(pending, response); });
+    } else { sendResponse(pending, response); }
+}
+
+void StubServer::handleDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(QObject::sender());
+    if (!socket) { return; }
+    _connections--;
+    _requests.remove(socket);
+    _responses.remove(socket);
+    socket->deleteLater();
+}
+
+void StubServer::handlePace()
+{
+    // each connection gets the full bandwidth, like separate clients would
+    qint64 chunk = _bandwidth * STUBSERVER_PACE_INTERVAL / 1000;
+    if (chunk < 1) { chunk = 1; }
+    QList<QTcpSocket*> sockets = _responses.keys();
+    for (int i = 0; i < sockets.size(); ++i) {
+        QTcpSocket *socket = sockets.at(i);
+        QByteArray &response = _responses[socket];
+        socket->write(response.left(int(chunk)));
+        response.remove(0, int(chunk));
+        if (response.isEmpty()) {
+            _responses.remove(socket);
+            socket->disconnectFromHost();
+        }
+    }
+    if (_responses.isEmpty()) { _pacer->stop(); }
+}
+
+const QByteArray StubServer::getResponse(const QByteArray &request)
+{
+    _requestCount++;
+
+    QList<QByteArray> lines = request.split('\n');
+    QList<QByteArray> method = lines.takeFirst().trimmed().split(' ');
+    QHash<QByteArray, QByteArray> headers;
+    for (int i = 0; i < lines.size(); ++i) {
+        int colon = lines.at(i).indexOf(':');
+        if (colon < 1) { continue; }
+        headers.insert(lines.at(i).left(colon).trimmed().toLower(), lines.at(i).mid(colon + 1).trimmed());
+    }
+
+    if (method.size() < 2 || method.at(0) != "GET") { return getStatus(405, "Method Not Allowed"); }
+    if (_failures > 0) { // injected, the client should retry
+        _failures--;
+        _failureCount++;
+        return getStatus(STUBSERVER_ERROR_STATUS, "Service Unavailable");
+    }
+
+    QString path = QString::fromUtf8(method.at(1)).section("?", 0, 0);
+    if (!_files.contains(path)) { return getStatus(404, "Not Found"); }
+    const FileSpecs &file = _files[path];
+
+    QByteArray validators = "ETag: " + file.etag + "\r\n" +
+                            "Last-Modified: Thu, 25 Nov 2021 19:00:00 GMT\r\n";
+    bool conditional = headers.contains("if-none-match") || headers.contains("if-modified-since");
+    if (conditional && (headers.value("if-none-match") == file.etag || _notModified > 0)) {
+        if (_notModified > 0) { _notModified--; }
+        _notModifiedCount++;
+        return getStatus(304, "Not Modified", validators);
+    }
+    return getStatus(200, "OK", validators + "Content-Type: " + file.type + "\r\n", file.data);
+}
+
+const QByteArray StubServer::getStatus(int code,
+                                       const QByteArray &reason,
+                                       const QByteArray &headers,
+                                       const QByteArray &body)
+{
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(code) + " " + reason + "\r\n";
+    response.append(headers);
+    response.append("Content-Length: " + QByteArray::number(body.size()) + "\r\n");
+    response.append("Connection: close\r\n\r\n");
+    response.append(body);
+    return response;
+}
+
+void StubServer::sendResponse(QPointer<QTcpSocket> socket,
+                              const QByteArray &response)
+{
+    if (!socket) { return; } // client went away
+    if (_bandwidth < 1) {
+        socket->write(response);
+        socket->disconnectFromHost();
+        return;
+    }
+    _responses.insert(socket, response);
+    if (!_pacer->isActive()) { _pacer->start(); }
+}
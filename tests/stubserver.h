@@ -0,0 +1,102 @@
+/*
+#
+# Natron Plug-in Manager
+#
+# Copyright (c) Ole-André Rodlie. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+*/
+
+#ifndef STUBSERVER_H
+#define STUBSERVER_H
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QPointer>
+#include <QTimer>
+#include <QHash>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+
+// interval (ms) between writes when the bandwidth is limited
+#define STUBSERVER_PACE_INTERVAL 100
+
+// status returned for injected errors
+#define STUBSERVER_ERROR_STATUS 503
+
+class StubServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+
+    struct FileSpecs
+    {
+        QByteArray data;
+        QByteArray type;
+        QByteArray etag;
+    };
+
+    explicit StubServer(QObject *parent = nullptr);
+
+    bool start();
+    void addFile(const QString &path,
+                 const QByteArray &data,
+                 const QByteArray &type = "application/octet-stream");
+    const QUrl getUrl(const QString &path);
+
+    void setLatency(int ms);
+    void setBandwidth(qint64 bytesPerSecond);
+    void setFailures(int count);
+    void setNotModified(int count);
+
+    int getRequests();
+    int getFailures();
+    int getNotModified();
+    bool isIdle();
+
+private slots:
+
+    void handleNewConnection();
+    void handleReadyRead();
+    void handleDisconnected();
+    void handlePace();
+
+private:
+
+    QHash<QString, FileSpecs> _files;
+    QHash<QTcpSocket*, QByteArray> _requests;
+    QHash<QTcpSocket*, QByteArray> _responses;
+    QTimer *_pacer;
+    int _latency;
+    qint64 _bandwidth;
+    int _failures;
+    int _notModified;
+    int _connections;
+    int _requestCount;
+    int _failureCount;
+    int _notModifiedCount;
+
+    const QByteArray getResponse(const QByteArray &request);
+    const QByteArray getStatus(int code,
+                               const QByteArray &reason,
+                               const QByteArray &headers = QByteArray(),
+                               const QByteArray &body = QByteArray());
+    void sendResponse(QPointer<QTcpSocket> socket,
+                      const QByteArray &response);
+};
+
+#endif // STUBSERVER_H